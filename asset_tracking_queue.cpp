@@ -0,0 +1,157 @@
+/*
+ * Fledge "Python 2.7" filter asset tracking queue.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <chrono>
+
+#include <logger.h>
+#include <asset_tracking.h>
+
+#include "asset_tracking_queue.h"
+
+// Asset tracking event name for filters
+#define ASSET_TRACKING_EVENT "Filter"
+// Maximum wait of the background thread between two checks
+#define ASSET_TRACKING_FLUSH_INTERVAL 1000
+
+using namespace std;
+
+/**
+ * Constructor: start the background thread
+ *
+ * @param service	The service (category) name of the tracked tuples
+ */
+AssetTrackingQueue::AssetTrackingQueue(const string& service) :
+					m_service(service),
+					m_head(NULL),
+					m_depth(0),
+					m_running(true),
+					m_thread(&AssetTrackingQueue::run, this)
+{
+}
+
+/**
+ * Destructor: stop the background thread.
+ * Pending tuples are flushed before the thread exits.
+ */
+AssetTrackingQueue::~AssetTrackingQueue()
+{
+	m_running = false;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_cv.notify_one();
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/**
+ * Queue an asset for tracking.
+ *
+ * Only assets not seen before by this filter are queued,
+ * the push onto the list is a single compare and swap.
+ *
+ * @param assetName	The asset name
+ */
+void AssetTrackingQueue::add(const string& assetName)
+{
+	if (assetName == m_lastAsset)
+	{
+		return;
+	}
+	m_lastAsset = assetName;
+
+	if (m_queued.find(assetName) != m_queued.end())
+	{
+		return;
+	}
+	m_queued.insert(assetName);
+
+	Tuple* tuple = new Tuple;
+	tuple->assetName = assetName;
+	tuple->next = m_head.load(memory_order_relaxed);
+	while (!m_head.compare_exchange_weak(tuple->next,
+					     tuple,
+					     memory_order_release,
+					     memory_order_relaxed))
+		;
+	m_depth.fetch_add(1, memory_order_relaxed);
+
+	// Wake up the flusher only on empty to non empty transition
+	if (tuple->next == NULL)
+	{
+		m_cv.notify_one();
+	}
+}
+
+/**
+ * Background thread: wait for queued tuples and
+ * register them with the AssetTracker
+ */
+void AssetTrackingQueue::run()
+{
+	while (m_running)
+	{
+		{
+			unique_lock<mutex> lck(m_mutex);
+			m_cv.wait_for(lck,
+				      chrono::milliseconds(ASSET_TRACKING_FLUSH_INTERVAL),
+				      [this] { return !m_running ||
+						      m_head.load(memory_order_relaxed) != NULL; });
+		}
+		flush();
+	}
+	flush();
+}
+
+/**
+ * Take all the pending tuples and send them to the AssetTracker
+ * in the order they have been queued
+ */
+void AssetTrackingQueue::flush()
+{
+	Tuple* list = m_head.exchange(NULL, memory_order_acquire);
+
+	// Reverse the list to preserve insertion order
+	Tuple* ordered = NULL;
+	while (list)
+	{
+		Tuple* next = list->next;
+		list->next = ordered;
+		ordered = list;
+		list = next;
+	}
+
+	// No tracker when the plugin runs outside a service
+	AssetTracker* tracker = AssetTracker::getAssetTracker();
+
+	while (ordered)
+	{
+		Tuple* next = ordered->next;
+		try
+		{
+			if (tracker)
+			{
+				tracker->addAssetTrackingTuple(m_service,
+							       ordered->assetName,
+							       string(ASSET_TRACKING_EVENT));
+			}
+		}
+		catch (exception& e)
+		{
+			Logger::getLogger()->error("Asset tracking of '%s' for '%s' failed: %s",
+						   ordered->assetName.c_str(),
+						   m_service.c_str(),
+						   e.what());
+		}
+		delete ordered;
+		m_depth.fetch_sub(1, memory_order_relaxed);
+		ordered = next;
+	}
+}
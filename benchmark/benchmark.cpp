@@ -0,0 +1,506 @@
+/*
+ * Fledge "Python 2.7" filter benchmark.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <Python.h>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Scripts are named <category>_script_<method>.py, as uploaded by Fledge
+#define BENCHMARK_SCRIPT_PREFIX "benchmark_script_"
+// Batches run before the measurement
+#define BENCHMARK_WARMUP_BATCHES 3
+// Minimum measured batches
+#define BENCHMARK_MIN_BATCHES 5
+
+static const char* shapeNames[SHAPE_COUNT] = {
+	"temperature", "vibration", "strings", "mixed"
+};
+
+static const char* scriptNames[SCRIPT_COUNT] = {
+	"passthrough", "drop90", "mutateall"
+};
+
+// Body of each script, after set_filter_config()
+static const char* scriptBodies[SCRIPT_COUNT] = {
+	"def passthrough(readings):\n"
+	"    return readings\n",
+
+	"def drop90(readings):\n"
+	"    return readings[::10]\n",
+
+	"def mutateall(readings):\n"
+	"    for elem in readings:\n"
+	"        reading = elem['reading']\n"
+	"        for key in reading:\n"
+	"            value = reading[key]\n"
+	"            if isinstance(value, str):\n"
+	"                reading[key] = value[:-1] + 'x'\n"
+	"            else:\n"
+	"                reading[key] = value * 2\n"
+	"    return readings\n"
+};
+
+// Scripts directory
+static string scriptsPath;
+
+/**
+ * Return the file of a benchmark script
+ *
+ * @param script	The script
+ * @return		The script path
+ */
+string scriptFile(BenchmarkScript script)
+{
+	return scriptsPath + "/" BENCHMARK_SCRIPT_PREFIX + scriptNames[script] + ".py";
+}
+
+/**
+ * Write a script in the scripts directory, with the name
+ * Fledge gives to uploaded scripts, for a BenchmarkFilter
+ *
+ * @param method	The script method name
+ * @param body		The script, after set_filter_config()
+ * @return		The script path, empty on error
+ */
+string writeScript(const string& method, const string& body)
+{
+	string path = scriptsPath + "/" BENCHMARK_SCRIPT_PREFIX + method + ".py";
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+	{
+		perror(path.c_str());
+		return "";
+	}
+	fputs("import json\n"
+	      "\n"
+	      "def set_filter_config(configuration):\n"
+	      "    return True\n"
+	      "\n",
+	      file);
+	fputs(body.c_str(), file);
+	fclose(file);
+	return path;
+}
+
+/**
+ * Copy a script file to the scripts directory, with the
+ * name Fledge gives to uploaded scripts
+ *
+ * @param source	The script to copy
+ * @param method	The script method name
+ * @return		The script path, empty on error
+ */
+string copyScript(const string& source, const string& method)
+{
+	FILE* in = fopen(source.c_str(), "r");
+	if (!in)
+	{
+		perror(source.c_str());
+		return "";
+	}
+	string path = scriptsPath + "/" BENCHMARK_SCRIPT_PREFIX + method + ".py";
+	FILE* out = fopen(path.c_str(), "w");
+	if (!out)
+	{
+		perror(path.c_str());
+		fclose(in);
+		return "";
+	}
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		fwrite(buffer, 1, n, out);
+	}
+	fclose(in);
+	fclose(out);
+	return path;
+}
+
+/**
+ * Return the current time of the monotonic clock
+ *
+ * @return	Microseconds
+ */
+uint64_t monotonicMicroseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Return the resident memory of the process
+ *
+ * @return	Resident memory in kB, 0 if not available
+ */
+long residentKb()
+{
+	long pages = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm)
+	{
+		long size;
+		if (fscanf(statm, "%ld %ld", &size, &pages) != 2)
+		{
+			pages = 0;
+		}
+		fclose(statm);
+	}
+	return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * Map the shared memory statistics of a filter instance
+ *
+ * @param filterName	The filter category name
+ * @return		The statistics, to unmap with unmapStatistics(),
+ *			NULL if not available
+ */
+const StatisticsLayout* mapStatistics(const string& filterName)
+{
+	string segment = StatisticsPage::segmentName(filterName);
+	int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	void* memory = mmap(NULL, sizeof(StatisticsLayout), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	const StatisticsLayout* layout = (const StatisticsLayout *)memory;
+	if (layout->magic != STATISTICS_PAGE_MAGIC)
+	{
+		munmap(memory, sizeof(StatisticsLayout));
+		return NULL;
+	}
+	return layout;
+}
+
+/**
+ * Unmap statistics returned by mapStatistics()
+ *
+ * @param layout	The statistics
+ */
+void unmapStatistics(const StatisticsLayout* layout)
+{
+	munmap((void *)layout, sizeof(StatisticsLayout));
+}
+
+const char* shapeName(ReadingShape shape)
+{
+	return shapeNames[shape];
+}
+
+const char* scriptName(BenchmarkScript script)
+{
+	return scriptNames[script];
+}
+
+/**
+ * Create a Fledge data directory with the benchmark scripts,
+ * used by the plugin through FLEDGE_DATA, and initialise the
+ * Python interpreter, so that it is kept across filter instances
+ *
+ * @param initialise	Initialise the Python interpreter
+ * @return		False on error
+ */
+bool setupBenchmark(bool initialise)
+{
+	char dataDir[] = "/tmp/python27-benchmark-XXXXXX";
+	if (!mkdtemp(dataDir))
+	{
+		perror("mkdtemp");
+		return false;
+	}
+	scriptsPath = string(dataDir) + "/scripts";
+	if (mkdir(scriptsPath.c_str(), 0755) != 0)
+	{
+		perror("mkdir");
+		return false;
+	}
+	setenv("FLEDGE_DATA", dataDir, 1);
+
+	for (int script = 0; script < SCRIPT_COUNT; script++)
+	{
+		if (writeScript(scriptNames[script], scriptBodies[script]).empty())
+		{
+			return false;
+		}
+	}
+
+	if (initialise)
+	{
+		// The plugin does not finalise an interpreter it has not initialised
+		Py_Initialize();
+		PyEval_InitThreads();
+		PyEval_SaveThread();
+	}
+
+	return true;
+}
+
+/**
+ * Create a filter instance running one of the benchmark scripts
+ *
+ * @param name		The filter category name
+ * @param script	The script to run
+ * @param extraItems	Additional configuration items, as JSON
+ *			members with a leading comma
+ */
+BenchmarkFilter::BenchmarkFilter(const string& name,
+				 BenchmarkScript script,
+				 const string& extraItems) :
+				BenchmarkFilter(name, scriptFile(script), extraItems)
+{
+}
+
+/**
+ * Create a filter instance running a script of the scripts
+ * directory, see writeScript()
+ *
+ * @param name		The filter category name
+ * @param file		The script path
+ * @param extraItems	Additional configuration items, as JSON
+ *			members with a leading comma
+ * @param scriptConfig	The JSON configuration of the script
+ */
+BenchmarkFilter::BenchmarkFilter(const string& name,
+				 const string& file,
+				 const string& extraItems,
+				 const string& scriptConfig) :
+				m_config(NULL),
+				m_handle(NULL),
+				m_forwarded(0),
+				m_keep(false),
+				m_output(NULL),
+				m_initTime(0)
+{
+	// Quoted as a JSON string value
+	string config;
+	for (string::const_iterator c = scriptConfig.begin(); c != scriptConfig.end(); ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			config += '\\';
+		}
+		config += *c;
+	}
+	string json = "{\"plugin\": {\"description\": \"\", \"type\": \"string\", "
+				"\"default\": \"python27\", \"value\": \"python27\"}, "
+		       "\"enable\": {\"description\": \"\", \"type\": \"boolean\", "
+				"\"default\": \"true\", \"value\": \"true\"}, "
+		       "\"config\": {\"description\": \"\", \"type\": \"JSON\", "
+				"\"default\": \"{}\", \"value\": \"" + config + "\"}, "
+		       "\"script\": {\"description\": \"\", \"type\": \"script\", "
+				"\"default\": \"\", \"value\": \"\", "
+				"\"file\": \"" + file + "\"}" +
+		       extraItems + "}";
+
+	m_config = new ConfigCategory(name, json);
+	uint64_t start = monotonicMicroseconds();
+	m_handle = plugin_init(m_config, (OUTPUT_HANDLE *)this, BenchmarkFilter::output);
+	m_initTime = monotonicMicroseconds() - start;
+	if (!m_handle)
+	{
+		fprintf(stderr, "Filter '%s': plugin_init failed\n", name.c_str());
+	}
+}
+
+/**
+ * Destructor: shutdown the filter instance
+ */
+BenchmarkFilter::~BenchmarkFilter()
+{
+	if (m_handle)
+	{
+		plugin_shutdown((PLUGIN_HANDLE *)m_handle);
+	}
+	delete m_output;
+	delete m_config;
+}
+
+/**
+ * Pass a batch to the filter, which takes its ownership
+ *
+ * @param readings	The batch of readings
+ */
+void BenchmarkFilter::ingest(ReadingSet* readings)
+{
+	plugin_ingest((PLUGIN_HANDLE *)m_handle, (READINGSET *)readings);
+}
+
+/**
+ * Return the last output of the filter, kept if keepOutput()
+ * has been called, and pass its ownership to the caller
+ *
+ * @return	The last output or NULL
+ */
+ReadingSet* BenchmarkFilter::takeOutput()
+{
+	ReadingSet* output = m_output;
+	m_output = NULL;
+	return output;
+}
+
+/**
+ * Output of the filter: count the readings and delete them,
+ * or keep the last output
+ *
+ * @param outHandle	The BenchmarkFilter
+ * @param readings	The filter output
+ */
+void BenchmarkFilter::output(OUTPUT_HANDLE* outHandle, READINGSET* readings)
+{
+	BenchmarkFilter* filter = (BenchmarkFilter *)outHandle;
+	ReadingSet* readingSet = (ReadingSet *)readings;
+	filter->m_forwarded += readingSet->getCount();
+	if (filter->m_keep)
+	{
+		delete filter->m_output;
+		filter->m_output = readingSet;
+	}
+	else
+	{
+		delete readingSet;
+	}
+}
+
+/**
+ * Create a batch of readings. Values are deterministic,
+ * so that runs of the same scenario convert the same data.
+ *
+ * @param shape		The readings to create
+ * @param size		The number of readings
+ * @return		New ReadingSet
+ */
+ReadingSet* createBatch(ReadingShape shape, unsigned long size)
+{
+	static const string message(4096, 'm');
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	vector<Reading *> readings;
+	readings.reserve(size);
+	for (unsigned long i = 0; i < size; i++)
+	{
+		vector<Datapoint *> values;
+		string asset;
+		switch (shape)
+		{
+			case SHAPE_TEMPERATURE:
+			{
+				asset = "temperature";
+				DatapointValue temperature(20.0 + (i % 100) / 10.0);
+				DatapointValue humidity(40.0 + (i % 50) / 5.0);
+				values.push_back(new Datapoint("temperature", temperature));
+				values.push_back(new Datapoint("humidity", humidity));
+				break;
+			}
+			case SHAPE_VIBRATION:
+			{
+				asset = "vibration";
+				for (int axis = 0; axis < 60; axis++)
+				{
+					char name[8];
+					snprintf(name, sizeof(name), "x%d", axis);
+					DatapointValue value((double)((i + axis) % 1000) / 1000.0);
+					values.push_back(new Datapoint(name, value));
+				}
+				break;
+			}
+			case SHAPE_STRINGS:
+			{
+				asset = "log";
+				DatapointValue value(message);
+				values.push_back(new Datapoint("message", value));
+				break;
+			}
+			default:
+			{
+				char name[16];
+				snprintf(name, sizeof(name), "sensor%lu", i % 10);
+				asset = name;
+				DatapointValue count((long)i);
+				DatapointValue value((double)(i % 1000) / 10.0);
+				DatapointValue state(string(i % 3 ? "running" : "stopped"));
+				values.push_back(new Datapoint("count", count));
+				values.push_back(new Datapoint("value", value));
+				values.push_back(new Datapoint("state", state));
+				break;
+			}
+		}
+		Reading* reading = new Reading(asset, values);
+		reading->setUserTimestamp(now);
+		readings.push_back(reading);
+	}
+	return new ReadingSet(&readings);
+}
+
+/**
+ * Run batches through a filter for the given time
+ * and measure the plugin_ingest calls
+ *
+ * @param name		The result name
+ * @param filter	The filter instance
+ * @param shape		The readings of the batches
+ * @param batchSize	The readings per batch
+ * @param seconds	Measurement time
+ * @return		The measured result
+ */
+BenchmarkResult runIngest(const string& name,
+			  BenchmarkFilter& filter,
+			  ReadingShape shape,
+			  unsigned long batchSize,
+			  double seconds)
+{
+	for (int i = 0; i < BENCHMARK_WARMUP_BATCHES; i++)
+	{
+		filter.ingest(createBatch(shape, batchSize));
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.batches = 0;
+	result.readings = 0;
+
+	uint64_t ingestTime = 0;
+	uint64_t end = monotonicMicroseconds() + (uint64_t)(seconds * 1000000);
+	while (result.batches < BENCHMARK_MIN_BATCHES || monotonicMicroseconds() < end)
+	{
+		// Batch creation is not measured
+		ReadingSet* batch = createBatch(shape, batchSize);
+		uint64_t start = monotonicMicroseconds();
+		filter.ingest(batch);
+		uint64_t elapsed = monotonicMicroseconds() - start;
+
+		ingestTime += elapsed;
+		result.latency.add(elapsed);
+		result.batches++;
+		result.readings += batchSize;
+	}
+	result.throughput = ingestTime ? result.readings * 1e6 / ingestTime : 0.0;
+
+	return result;
+}
@@ -0,0 +1,142 @@
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+/*
+ * Fledge "Python 2.7" filter benchmark.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <filter_plugin.h>
+#include <reading_set.h>
+
+#include "histogram.h"
+#include "statistics_page.h"
+
+// Version of the scenario corpus: results of different
+// versions can not be compared
+#define BENCHMARK_CORPUS_VERSION 1
+
+/**
+ * The plugin entry points, linked from the plugin library
+ */
+extern "C" {
+PLUGIN_HANDLE	plugin_init(ConfigCategory* config,
+			    OUTPUT_HANDLE* outHandle,
+			    OUTPUT_STREAM output);
+void		plugin_ingest(PLUGIN_HANDLE* handle, READINGSET* readingSet);
+void		plugin_shutdown(PLUGIN_HANDLE* handle);
+};
+
+/**
+ * Readings generated for the benchmark scenarios
+ */
+typedef enum
+{
+	SHAPE_TEMPERATURE,	// One asset, two float datapoints
+	SHAPE_VIBRATION,	// One asset, 60 float datapoints
+	SHAPE_STRINGS,		// One asset, a 4 kB string datapoint
+	SHAPE_MIXED,		// Ten assets, integer, float and string datapoints
+	SHAPE_COUNT
+} ReadingShape;
+
+/**
+ * Scripts of the benchmark scenarios
+ */
+typedef enum
+{
+	SCRIPT_PASSTHROUGH,	// Returns the readings
+	SCRIPT_DROP90,		// Returns one reading every ten
+	SCRIPT_MUTATE_ALL,	// Changes every datapoint value
+	SCRIPT_COUNT
+} BenchmarkScript;
+
+/**
+ * Result of a benchmark run
+ */
+typedef struct
+{
+	std::string	name;
+	uint64_t	batches;
+	uint64_t	readings;
+	// Readings per second of plugin_ingest time
+	double		throughput;
+	// Latency of plugin_ingest, in microseconds
+	Histogram	latency;
+} BenchmarkResult;
+
+/**
+ * A python27 filter instance created through plugin_init,
+ * forwarding to an output that counts and deletes the readings,
+ * or keeps the last output for the tests to check
+ */
+class BenchmarkFilter
+{
+	public:
+		BenchmarkFilter(const std::string& name,
+				BenchmarkScript script,
+				const std::string& extraItems = "");
+		BenchmarkFilter(const std::string& name,
+				const std::string& file,
+				const std::string& extraItems = "",
+				const std::string& scriptConfig = "{}");
+		~BenchmarkFilter();
+
+		bool	ready() const { return m_handle != NULL; };
+		void	ingest(ReadingSet* readings);
+		uint64_t
+			forwarded() const { return m_forwarded; };
+		void	keepOutput(bool keep) { m_keep = keep; };
+		ReadingSet*
+			takeOutput();
+		// plugin_init time, in microseconds
+		uint64_t
+			initTime() const { return m_initTime; };
+
+	private:
+		static void
+			output(OUTPUT_HANDLE* outHandle, READINGSET* readings);
+
+	private:
+		ConfigCategory*	m_config;
+		PLUGIN_HANDLE	m_handle;
+		uint64_t	m_forwarded;
+		bool		m_keep;
+		ReadingSet*	m_output;
+		uint64_t	m_initTime;
+};
+
+bool		setupBenchmark(bool initialise = true);
+const char*	shapeName(ReadingShape shape);
+const char*	scriptName(BenchmarkScript script);
+std::string	scriptFile(BenchmarkScript script);
+std::string	writeScript(const std::string& method, const std::string& body);
+std::string	copyScript(const std::string& source, const std::string& method);
+ReadingSet*	createBatch(ReadingShape shape, unsigned long size);
+uint64_t	monotonicMicroseconds();
+long		residentKb();
+const StatisticsLayout*
+		mapStatistics(const std::string& filterName);
+void		unmapStatistics(const StatisticsLayout* layout);
+BenchmarkResult	runIngest(const std::string& name,
+			  BenchmarkFilter& filter,
+			  ReadingShape shape,
+			  unsigned long batchSize,
+			  double seconds);
+
+int		runCorpus(double seconds,
+			  const std::string& only,
+			  const std::string& outputFile,
+			  const std::string& baselineFile,
+			  double tolerance);
+int		runContention(const std::vector<unsigned int>& instances,
+			      const std::string& scenario,
+			      double seconds);
+int		runStartup(const std::vector<unsigned int>& instances,
+			   unsigned int repeats);
+#endif
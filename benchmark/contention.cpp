@@ -0,0 +1,215 @@
+/*
+ * Fledge "Python 2.7" filter multi-instance contention benchmark.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "benchmark.h"
+
+using namespace std;
+
+/**
+ * Read the time spent in each ingest stage by a filter
+ * instance from its shared memory statistics
+ *
+ * @param filterName	The filter category name
+ * @param stageTime	Nanoseconds of each stage
+ * @return		False if the statistics are not available
+ */
+static bool readStageTime(const string& filterName, uint64_t* stageTime)
+{
+	const StatisticsLayout* layout = mapStatistics(filterName);
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		stageTime[stage] = layout ? layout->stageTime[stage].load(memory_order_relaxed) : 0;
+	}
+	if (!layout)
+	{
+		return false;
+	}
+	unmapStatistics(layout);
+	return true;
+}
+
+/**
+ * Find a scenario of the corpus by name
+ *
+ * @param name		Scenario name: shape/script/size
+ * @param shape		The reading shape
+ * @param script	The script
+ * @param size		The batch size
+ * @return		False if the name is not valid
+ */
+static bool parseScenario(const string& name,
+			  ReadingShape& shape,
+			  BenchmarkScript& script,
+			  unsigned long& size)
+{
+	size_t first = name.find('/');
+	size_t second = name.find('/', first == string::npos ? 0 : first + 1);
+	if (first == string::npos || second == string::npos)
+	{
+		return false;
+	}
+	string shapePart = name.substr(0, first);
+	string scriptPart = name.substr(first + 1, second - first - 1);
+	size = strtoul(name.c_str() + second + 1, NULL, 10);
+
+	int i;
+	for (i = 0; i < SHAPE_COUNT && shapePart != shapeName((ReadingShape)i); i++);
+	if (i == SHAPE_COUNT)
+	{
+		return false;
+	}
+	shape = (ReadingShape)i;
+	for (i = 0; i < SCRIPT_COUNT && scriptPart != scriptName((BenchmarkScript)i); i++);
+	if (i == SCRIPT_COUNT)
+	{
+		return false;
+	}
+	script = (BenchmarkScript)i;
+	return size > 0;
+}
+
+/**
+ * Run one scenario with N filter instances in one process,
+ * each driven by its own thread, for each N given.
+ *
+ * Reports the aggregate throughput, the readings of all the
+ * instances over the wall clock time of the run, from the start
+ * of the first thread to the end of the last one, the latency
+ * of each instance, the share of the filter stage time spent
+ * waiting for the GIL, read from the statistics segments, and
+ * the scaling efficiency: aggregate throughput per instance
+ * relative to the first N.
+ *
+ * @param instances	The numbers of instances to run
+ * @param scenario	Scenario name: shape/script/size
+ * @param seconds	Measurement time
+ * @return		The program exit code
+ */
+int runContention(const vector<unsigned int>& instances,
+		  const string& scenario,
+		  double seconds)
+{
+	ReadingShape shape;
+	BenchmarkScript script;
+	unsigned long batchSize;
+	if (!parseScenario(scenario, shape, script, batchSize))
+	{
+		fprintf(stderr, "Invalid scenario '%s', expected shape/script/size\n", scenario.c_str());
+		return 2;
+	}
+
+	printf("Scenario %s\n", scenario.c_str());
+	printf("%10s %14s %12s %10s %10s  %s\n",
+	       "instances", "readings/s", "efficiency", "GIL wait", "mean us", "instance mean/p99 us");
+
+	double baseline = 0.0;
+	for (vector<unsigned int>::const_iterator n = instances.begin(); n != instances.end(); ++n)
+	{
+		vector<BenchmarkFilter *> filters;
+		vector<string> names;
+		for (unsigned int i = 0; i < *n; i++)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "benchmark-contention-%u", i);
+			names.push_back(name);
+			filters.push_back(new BenchmarkFilter(name, script));
+			if (!filters.back()->ready())
+			{
+				for (size_t j = 0; j < filters.size(); j++)
+				{
+					delete filters[j];
+				}
+				return 2;
+			}
+		}
+
+		vector<uint64_t> stageStart(*n * STAGE_COUNT, 0);
+		for (unsigned int i = 0; i < *n; i++)
+		{
+			readStageTime(names[i], &stageStart[i * STAGE_COUNT]);
+		}
+
+		// The wall clock time includes the warm-up and batch creation of
+		// each thread, run concurrently, as in a service
+		vector<BenchmarkResult> results(*n);
+		vector<thread> threads;
+		uint64_t start = monotonicMicroseconds();
+		for (unsigned int i = 0; i < *n; i++)
+		{
+			threads.push_back(thread([&, i]() {
+				results[i] = runIngest(names[i], *filters[i], shape, batchSize, seconds);
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+		uint64_t wallTime = monotonicMicroseconds() - start;
+
+		uint64_t readings = 0;
+		uint64_t gilWait = 0;
+		uint64_t stageTotal = 0;
+		uint64_t ingestTime = 0;
+		uint64_t batches = 0;
+		string perInstance;
+		for (unsigned int i = 0; i < *n; i++)
+		{
+			readings += results[i].readings;
+			batches += results[i].batches;
+			ingestTime += results[i].latency.sum();
+
+			uint64_t stageEnd[STAGE_COUNT];
+			if (readStageTime(names[i], stageEnd))
+			{
+				for (int stage = 0; stage < STAGE_COUNT; stage++)
+				{
+					uint64_t time = stageEnd[stage] - stageStart[i * STAGE_COUNT + stage];
+					stageTotal += time;
+					if (stage == STAGE_GIL_WAIT)
+					{
+						gilWait += time;
+					}
+				}
+			}
+
+			char line[48];
+			snprintf(line,
+				 sizeof(line),
+				 "%s%.0f/%llu",
+				 i ? " " : "",
+				 results[i].latency.mean(),
+				 (unsigned long long)results[i].latency.percentile(99));
+			perInstance += line;
+		}
+		double throughput = wallTime ? readings * 1e6 / wallTime : 0.0;
+		if (baseline == 0.0)
+		{
+			baseline = throughput / *n;
+		}
+
+		printf("%10u %14.0f %11.1f%% %9.1f%% %10.1f  %s\n",
+		       *n,
+		       throughput,
+		       baseline ? 100.0 * throughput / *n / baseline : 0.0,
+		       stageTotal ? 100.0 * gilWait / stageTotal : 0.0,
+		       batches ? (double)ingestTime / batches : 0.0,
+		       perInstance.c_str());
+		fflush(stdout);
+
+		for (size_t i = 0; i < filters.size(); i++)
+		{
+			delete filters[i];
+		}
+	}
+	return 0;
+}
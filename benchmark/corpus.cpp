@@ -0,0 +1,222 @@
+/*
+ * Fledge "Python 2.7" filter benchmark scenario corpus.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+#include <rapidjson/document.h>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Batch sizes of each scenario
+static const unsigned long batchSizes[] = {1, 100, 10000};
+#define BATCH_SIZES (sizeof(batchSizes) / sizeof(batchSizes[0]))
+
+/**
+ * Write the results as JSON, to be used as a baseline
+ *
+ * @param file		The output file
+ * @param results	The results
+ * @return		False on error
+ */
+static bool writeResults(const string& file, const vector<BenchmarkResult>& results)
+{
+	FILE* output = fopen(file.c_str(), "w");
+	if (!output)
+	{
+		fprintf(stderr, "Unable to write '%s': %s\n", file.c_str(), strerror(errno));
+		return false;
+	}
+	fprintf(output, "{\n  \"corpus\": %d,\n  \"scenarios\": {", BENCHMARK_CORPUS_VERSION);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		fprintf(output,
+			"%s\n    \"%s\": {\"throughput\": %.1f, \"mean\": %.1f, \"p99\": %llu}",
+			i ? "," : "",
+			results[i].name.c_str(),
+			results[i].throughput,
+			results[i].latency.mean(),
+			(unsigned long long)results[i].latency.percentile(99));
+	}
+	fprintf(output, "\n  }\n}\n");
+	fclose(output);
+	return true;
+}
+
+/**
+ * Compare the results with a baseline: throughput lower or mean
+ * latency higher than the baseline by more than the tolerance
+ * are regressions. The p99 latency is only reported, as it
+ * is measured with power of two buckets.
+ *
+ * @param file		The baseline file, written by --output
+ * @param results	The results
+ * @param tolerance	Tolerance, percent
+ * @return		0 if no regression, 1 on regressions, 2 on error
+ */
+static int compareBaseline(const string& file,
+			   const vector<BenchmarkResult>& results,
+			   double tolerance)
+{
+	ifstream input(file.c_str());
+	if (!input)
+	{
+		fprintf(stderr, "Unable to read baseline '%s'\n", file.c_str());
+		return 2;
+	}
+	stringstream content;
+	content << input.rdbuf();
+
+	rapidjson::Document baseline;
+	baseline.Parse(content.str().c_str());
+	if (baseline.HasParseError() ||
+	    !baseline.IsObject() ||
+	    !baseline.HasMember("corpus") ||
+	    !baseline["corpus"].IsInt() ||
+	    !baseline.HasMember("scenarios") ||
+	    !baseline["scenarios"].IsObject())
+	{
+		fprintf(stderr, "Baseline '%s' is not a benchmark result\n", file.c_str());
+		return 2;
+	}
+	if (baseline["corpus"].GetInt() != BENCHMARK_CORPUS_VERSION)
+	{
+		fprintf(stderr,
+			"Baseline '%s' is for corpus version %d, this is version %d\n",
+			file.c_str(),
+			baseline["corpus"].GetInt(),
+			BENCHMARK_CORPUS_VERSION);
+		return 2;
+	}
+
+	const rapidjson::Value& scenarios = baseline["scenarios"];
+	int regressions = 0;
+	printf("\nComparison with '%s', tolerance %.0f%%\n", file.c_str(), tolerance);
+	for (vector<BenchmarkResult>::const_iterator it = results.begin(); it != results.end(); ++it)
+	{
+		if (!scenarios.HasMember(it->name.c_str()))
+		{
+			printf("  %-32s not in baseline\n", it->name.c_str());
+			continue;
+		}
+		const rapidjson::Value& base = scenarios[it->name.c_str()];
+		if (!base.IsObject() ||
+		    !base.HasMember("throughput") || !base["throughput"].IsNumber() ||
+		    !base.HasMember("mean") || !base["mean"].IsNumber())
+		{
+			printf("  %-32s invalid baseline entry\n", it->name.c_str());
+			continue;
+		}
+		double baseThroughput = base["throughput"].GetDouble();
+		double baseMean = base["mean"].GetDouble();
+		double throughputChange = baseThroughput ?
+					  100.0 * (it->throughput - baseThroughput) / baseThroughput :
+					  0.0;
+		double meanChange = baseMean ?
+				    100.0 * (it->latency.mean() - baseMean) / baseMean :
+				    0.0;
+		bool regression = throughputChange < -tolerance || meanChange > tolerance;
+		if (regression)
+		{
+			regressions++;
+		}
+		printf("  %-32s throughput %+6.1f%%, mean latency %+6.1f%%%s\n",
+		       it->name.c_str(),
+		       throughputChange,
+		       meanChange,
+		       regression ? "  REGRESSION" : "");
+	}
+	printf("%d regressions\n", regressions);
+
+	return regressions ? 1 : 0;
+}
+
+/**
+ * Run the scenario corpus: each reading shape with each script
+ * at each batch size, one filter instance per script
+ *
+ * @param seconds	Measurement time of each scenario
+ * @param only		Run only the scenarios whose name contains this
+ * @param outputFile	Write the results to this file, if not empty
+ * @param baselineFile	Compare the results with this file, if not empty
+ * @param tolerance	Regression tolerance, percent
+ * @return		The program exit code
+ */
+int runCorpus(double seconds,
+	      const string& only,
+	      const string& outputFile,
+	      const string& baselineFile,
+	      double tolerance)
+{
+	vector<BenchmarkResult> results;
+
+	printf("%-32s %10s %14s %10s %10s\n", "scenario", "batches", "readings/s", "mean us", "p99 us");
+	for (int script = 0; script < SCRIPT_COUNT; script++)
+	{
+		BenchmarkFilter* filter = NULL;
+		for (int shape = 0; shape < SHAPE_COUNT; shape++)
+		{
+			for (size_t size = 0; size < BATCH_SIZES; size++)
+			{
+				char name[64];
+				snprintf(name,
+					 sizeof(name),
+					 "%s/%s/%lu",
+					 shapeName((ReadingShape)shape),
+					 scriptName((BenchmarkScript)script),
+					 batchSizes[size]);
+				if (!only.empty() && string(name).find(only) == string::npos)
+				{
+					continue;
+				}
+
+				if (!filter)
+				{
+					filter = new BenchmarkFilter(string("benchmark-") +
+								     scriptName((BenchmarkScript)script),
+								     (BenchmarkScript)script);
+					if (!filter->ready())
+					{
+						delete filter;
+						return 2;
+					}
+				}
+
+				BenchmarkResult result = runIngest(name,
+								   *filter,
+								   (ReadingShape)shape,
+								   batchSizes[size],
+								   seconds);
+				printf("%-32s %10llu %14.0f %10.1f %10llu\n",
+				       result.name.c_str(),
+				       (unsigned long long)result.batches,
+				       result.throughput,
+				       result.latency.mean(),
+				       (unsigned long long)result.latency.percentile(99));
+				fflush(stdout);
+				results.push_back(result);
+			}
+		}
+		delete filter;
+	}
+
+	if (!outputFile.empty() && !writeResults(outputFile, results))
+	{
+		return 2;
+	}
+	if (!baselineFile.empty())
+	{
+		return compareBaseline(baselineFile, results, tolerance);
+	}
+	return 0;
+}
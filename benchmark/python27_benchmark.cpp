@@ -0,0 +1,147 @@
+/*
+ * Fledge "Python 2.7" filter benchmark.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Scenario of the contention runs, if not given
+#define CONTENTION_SCENARIO "mixed/passthrough/100"
+// Runs of each startup measure, if not given
+#define STARTUP_REPEATS 5
+
+static void usage(const char* program)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -t seconds       measurement time of each scenario (default 2)\n"
+		"  -s name          run only the scenarios whose name contains name\n"
+		"  -o file          write the results as JSON, usable as a baseline\n"
+		"  -b file          compare the results with a baseline, exit 1 on regressions\n"
+		"  -r percent       regression tolerance (default 10)\n"
+		"  -c 1,2,4,8       run one scenario with each number of filter instances\n"
+		"                   ingesting from their own thread; -s gives the scenario\n"
+		"                   (default " CONTENTION_SCENARIO ")\n"
+		"  -m 1,10,50       measure plugin_init time and resident memory of each\n"
+		"                   number of filter instances, cold and warm\n"
+		"  -n runs          runs of each startup measure (default %d)\n",
+		program,
+		STARTUP_REPEATS);
+}
+
+/**
+ * Parse a comma separated list of instance counts
+ *
+ * @param list		The list
+ * @param counts	The instance counts
+ * @return		False if the list is not valid
+ */
+static bool parseCounts(char* list, vector<unsigned int>& counts)
+{
+	while (*list)
+	{
+		unsigned long count = strtoul(list, &list, 10);
+		if (count == 0 || (*list && *list != ','))
+		{
+			return false;
+		}
+		counts.push_back(count);
+		if (*list)
+		{
+			list++;
+		}
+	}
+	return !counts.empty();
+}
+
+/**
+ * Run the python27 filter benchmark scenarios through
+ * plugin_init, plugin_ingest and plugin_shutdown
+ */
+int main(int argc, char** argv)
+{
+	double seconds = 2.0;
+	double tolerance = 10.0;
+	string only;
+	string outputFile;
+	string baselineFile;
+	vector<unsigned int> instances;
+	vector<unsigned int> startupInstances;
+	unsigned int repeats = STARTUP_REPEATS;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && strcmp(argv[i], "-t") == 0)
+		{
+			seconds = atof(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-s") == 0)
+		{
+			only = argv[++i];
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-o") == 0)
+		{
+			outputFile = argv[++i];
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-b") == 0)
+		{
+			baselineFile = argv[++i];
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-r") == 0)
+		{
+			tolerance = atof(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-c") == 0)
+		{
+			if (!parseCounts(argv[++i], instances))
+			{
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-m") == 0)
+		{
+			if (!parseCounts(argv[++i], startupInstances))
+			{
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-n") == 0)
+		{
+			repeats = atoi(argv[++i]);
+		}
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	// Startup runs initialise the interpreter in each measured process
+	if (!setupBenchmark(startupInstances.empty()))
+	{
+		return 2;
+	}
+
+	if (!startupInstances.empty())
+	{
+		return runStartup(startupInstances, repeats);
+	}
+
+	if (!instances.empty())
+	{
+		return runContention(instances, only.empty() ? CONTENTION_SCENARIO : only, seconds);
+	}
+	return runCorpus(seconds, only, outputFile, baselineFile, tolerance);
+}
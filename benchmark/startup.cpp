@@ -0,0 +1,310 @@
+/*
+ * Fledge "Python 2.7" filter startup time and memory benchmark.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <Python.h>
+
+#include "benchmark.h"
+#include "statistics_page.h"
+
+using namespace std;
+
+static const char* phaseNames[STARTUP_COUNT] = {
+	"interpreter", "path", "import", "config"
+};
+
+/**
+ * Measures of one startup run, written by the child process
+ */
+typedef struct
+{
+	// plugin_init of the first instance, milliseconds
+	double	first;
+	// Mean plugin_init of the other instances, milliseconds
+	double	next;
+	// All plugin_init calls, milliseconds
+	double	total;
+	// Each phase of plugin_init, as first and next, milliseconds
+	double	firstPhase[STARTUP_COUNT];
+	double	nextPhase[STARTUP_COUNT];
+	// Resident memory before and after the instances, kB
+	long	rssBefore;
+	long	rssAfter;
+} StartupSample;
+
+/**
+ * Name of a startup benchmark filter instance
+ *
+ * @param instance	The instance number
+ * @return		The filter category name
+ */
+static string instanceName(unsigned int instance)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "benchmark-startup-%u", instance);
+	return name;
+}
+
+/**
+ * Add the time of each plugin_init phase of a filter
+ * instance, read from its statistics. Nothing is added
+ * if the plugin publishes no statistics: built with the
+ * none instrumentation level, or an earlier version.
+ *
+ * @param filterName	The filter category name
+ * @param phaseTime	Milliseconds of each phase
+ */
+static void addPhaseTime(const string& filterName, double* phaseTime)
+{
+	const StatisticsLayout* layout = mapStatistics(filterName);
+	if (!layout)
+	{
+		return;
+	}
+	for (int phase = 0; phase < STARTUP_COUNT; phase++)
+	{
+		phaseTime[phase] += layout->startupTime[phase].load(memory_order_relaxed) / 1e6;
+	}
+	unmapStatistics(layout);
+}
+
+/**
+ * Create the filter instances in a new process and write the
+ * measures to the parent. The instances are not shut down:
+ * the process exits once measured. Only plugin_init is timed,
+ * split in phases by the statistics of each instance.
+ *
+ * A cold run starts with no interpreter, which the first
+ * plugin_init initialises, and no compiled script. A warm run
+ * adds the instances to a process where the interpreter runs
+ * and another instance has loaded the script, as a pipeline
+ * added to a running service.
+ *
+ * @param count		The number of instances
+ * @param warm		Warm run
+ * @param fd		The pipe to the parent
+ */
+static void startupChild(unsigned int count, bool warm, int fd)
+{
+	if (warm)
+	{
+		Py_Initialize();
+		PyEval_InitThreads();
+		PyEval_SaveThread();
+		BenchmarkFilter* running = new BenchmarkFilter("benchmark-startup-running",
+							       SCRIPT_PASSTHROUGH);
+		if (!running->ready())
+		{
+			_exit(2);
+		}
+	}
+
+	StartupSample sample;
+	memset(&sample, 0, sizeof(sample));
+	sample.rssBefore = residentKb();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		BenchmarkFilter* filter = new BenchmarkFilter(instanceName(i), SCRIPT_PASSTHROUGH);
+		if (!filter->ready())
+		{
+			_exit(2);
+		}
+		addPhaseTime(instanceName(i), i == 0 ? sample.firstPhase : sample.nextPhase);
+		if (i == 0)
+		{
+			sample.first = filter->initTime() / 1000.0;
+		}
+		sample.total += filter->initTime() / 1000.0;
+	}
+	sample.next = count > 1 ? (sample.total - sample.first) / (count - 1) : 0.0;
+	for (int phase = 0; phase < STARTUP_COUNT; phase++)
+	{
+		sample.nextPhase[phase] = count > 1 ? sample.nextPhase[phase] / (count - 1) : 0.0;
+	}
+	sample.rssAfter = residentKb();
+
+	_exit(write(fd, &sample, sizeof(sample)) == sizeof(sample) ? 0 : 2);
+}
+
+/**
+ * Run one startup measure in a new process
+ *
+ * @param count		The number of instances
+ * @param warm		Warm run
+ * @param sample	The measures
+ * @return		False on error
+ */
+static bool runStartupOnce(unsigned int count, bool warm, StartupSample& sample)
+{
+	// Cold runs compile the script
+	string compiled = scriptFile(SCRIPT_PASSTHROUGH) + "c";
+	if (!warm)
+	{
+		unlink(compiled.c_str());
+	}
+
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		perror("pipe");
+		return false;
+	}
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		startupChild(count, warm, fds[1]);
+	}
+	close(fds[1]);
+
+	bool received = read(fds[0], &sample, sizeof(sample)) == sizeof(sample);
+	close(fds[0]);
+	int status;
+	waitpid(pid, &status, 0);
+
+	// The child does not shut down the instances
+	shm_unlink(StatisticsPage::segmentName("benchmark-startup-running").c_str());
+	for (unsigned int i = 0; i < count; i++)
+	{
+		shm_unlink(StatisticsPage::segmentName(instanceName(i)).c_str());
+	}
+
+	if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		fprintf(stderr, "Startup run of %u instances failed\n", count);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Return the median of the samples for one measure
+ *
+ * @param samples	The samples
+ * @param field		The measure
+ * @return		The median
+ */
+template<typename T> static T median(const vector<StartupSample>& samples,
+				     T StartupSample::*field)
+{
+	vector<T> values;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		values.push_back(samples[i].*field);
+	}
+	sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+/**
+ * Return the median of the samples for one plugin_init phase
+ *
+ * @param samples	The samples
+ * @param field		The first or next phase times
+ * @param phase		The phase
+ * @return		The median
+ */
+static double medianPhase(const vector<StartupSample>& samples,
+			  double (StartupSample::*field)[STARTUP_COUNT],
+			  int phase)
+{
+	vector<double> values;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		values.push_back((samples[i].*field)[phase]);
+	}
+	sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+/**
+ * Measure the plugin_init time and the resident memory of
+ * each number of filter instances, cold and warm, then the
+ * time of each phase of plugin_init. Each run is a new
+ * process and the median of the repeated runs is reported.
+ *
+ * The benchmark must be set up without initialising the
+ * Python interpreter.
+ *
+ * @param instances	The numbers of instances to create
+ * @param repeats	Runs of each measure
+ * @return		The program exit code
+ */
+int runStartup(const vector<unsigned int>& instances, unsigned int repeats)
+{
+	printf("%-8s %10s %10s %10s %10s %12s %12s %14s\n",
+	       "run", "instances", "first ms", "next ms", "total ms",
+	       "RSS before", "RSS after", "kB / instance");
+	// Phase rows, printed after the totals
+	string phases;
+	for (int warm = 0; warm < 2; warm++)
+	{
+		for (vector<unsigned int>::const_iterator n = instances.begin(); n != instances.end(); ++n)
+		{
+			vector<StartupSample> samples;
+			for (unsigned int i = 0; i < max(repeats, 1U); i++)
+			{
+				StartupSample sample;
+				if (!runStartupOnce(*n, warm, sample))
+				{
+					return 2;
+				}
+				samples.push_back(sample);
+			}
+
+			long rssBefore = median(samples, &StartupSample::rssBefore);
+			long rssAfter = median(samples, &StartupSample::rssAfter);
+			printf("%-8s %10u %10.1f %10.1f %10.1f %9ld kB %9ld kB %14.0f\n",
+			       warm ? "warm" : "cold",
+			       *n,
+			       median(samples, &StartupSample::first),
+			       median(samples, &StartupSample::next),
+			       median(samples, &StartupSample::total),
+			       rssBefore,
+			       rssAfter,
+			       (double)(rssAfter - rssBefore) / *n);
+			fflush(stdout);
+
+			char row[256];
+			int length = snprintf(row, sizeof(row), "%-8s %10u", warm ? "warm" : "cold", *n);
+			for (int phase = 0; phase < STARTUP_COUNT; phase++)
+			{
+				char cell[32];
+				snprintf(cell,
+					 sizeof(cell),
+					 "%.1f/%.1f",
+					 medianPhase(samples, &StartupSample::firstPhase, phase),
+					 medianPhase(samples, &StartupSample::nextPhase, phase));
+				length += snprintf(row + length, sizeof(row) - length, " %14s", cell);
+			}
+			phases += string(row) + "\n";
+		}
+	}
+
+	printf("\nplugin_init phases, first/next ms\n%-8s %10s", "run", "instances");
+	for (int phase = 0; phase < STARTUP_COUNT; phase++)
+	{
+		printf(" %14s", phaseNames[phase]);
+	}
+	printf("\n%s", phases.c_str());
+	return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ * Fledge "Python 2.7" filter control socket.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+
+#include <logger.h>
+
+#include "control_socket.h"
+#include "python27.h"
+
+// Maximum wait for the command line of a connection
+#define CONTROL_READ_TIMEOUT 1
+
+using namespace std;
+
+/**
+ * Return the socket path of a filter instance: the filter
+ * name is changed as for the statistics segment name
+ *
+ * @param dataDir	The Fledge data directory
+ * @param filterName	The filter category name
+ * @return		The socket path
+ */
+string ControlSocket::socketPath(const string& dataDir, const string& filterName)
+{
+	return dataDir + CONTROL_SOCKET_PATH + StatisticsPage::segmentName(filterName) + ".sock";
+}
+
+/**
+ * Constructor: create the socket, readable and writable by
+ * the owner only, and start the background thread
+ *
+ * @param filter	The filter instance
+ * @param dataDir	The Fledge data directory
+ * @param filterName	The filter category name
+ */
+ControlSocket::ControlSocket(Python27Filter* filter,
+			     const string& dataDir,
+			     const string& filterName) :
+				m_filter(filter),
+				m_path(socketPath(dataDir, filterName)),
+				m_socket(-1)
+{
+	m_stop[0] = -1;
+	m_stop[1] = -1;
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (m_path.size() >= sizeof(address.sun_path))
+	{
+		Logger::getLogger()->warn("Filter '%s': control socket path '%s' is too long, "
+					  "control socket disabled",
+					  filterName.c_str(),
+					  m_path.c_str());
+		return;
+	}
+	strncpy(address.sun_path, m_path.c_str(), sizeof(address.sun_path) - 1);
+
+	// The run directory may not exist yet
+	mkdir((dataDir + CONTROL_SOCKET_PATH).c_str(), 0755);
+	// Left by a previous run of the service
+	unlink(m_path.c_str());
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m_socket < 0 ||
+	    bind(m_socket, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+	    chmod(m_path.c_str(), 0600) != 0 ||
+	    listen(m_socket, 4) != 0 ||
+	    pipe(m_stop) != 0)
+	{
+		Logger::getLogger()->warn("Filter '%s': unable to create control socket '%s': %s",
+					  filterName.c_str(),
+					  m_path.c_str(),
+					  strerror(errno));
+		if (m_socket >= 0)
+		{
+			close(m_socket);
+			m_socket = -1;
+			unlink(m_path.c_str());
+		}
+		return;
+	}
+
+	m_thread = thread(&ControlSocket::run, this);
+}
+
+/**
+ * Destructor: stop the background thread and remove the socket.
+ * Must not be called with the GIL held, as a command may be
+ * waiting for it.
+ */
+ControlSocket::~ControlSocket()
+{
+	if (m_thread.joinable())
+	{
+		char stop = 0;
+		if (write(m_stop[1], &stop, 1) != 1)
+		{
+			Logger::getLogger()->error("Unable to stop control socket '%s' thread",
+						   m_path.c_str());
+		}
+		m_thread.join();
+	}
+	if (m_socket >= 0)
+	{
+		close(m_socket);
+		unlink(m_path.c_str());
+	}
+	if (m_stop[0] >= 0)
+	{
+		close(m_stop[0]);
+		close(m_stop[1]);
+	}
+}
+
+/**
+ * Background thread: serve the connections, one at a time,
+ * until stopped by the destructor
+ */
+void ControlSocket::run()
+{
+	struct pollfd fds[2];
+	fds[0].fd = m_socket;
+	fds[0].events = POLLIN;
+	fds[1].fd = m_stop[0];
+	fds[1].events = POLLIN;
+
+	while (true)
+	{
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			Logger::getLogger()->error("Control socket '%s' poll error: %s",
+						   m_path.c_str(),
+						   strerror(errno));
+			return;
+		}
+		if (fds[1].revents)
+		{
+			return;
+		}
+		if (fds[0].revents & POLLIN)
+		{
+			int connection = accept4(m_socket, NULL, NULL, SOCK_CLOEXEC);
+			if (connection >= 0)
+			{
+				serve(connection);
+				close(connection);
+			}
+		}
+	}
+}
+
+/**
+ * Read a command line from a connection and write the reply
+ *
+ * @param connection	The accepted connection
+ */
+void ControlSocket::serve(int connection)
+{
+	struct timeval timeout = {CONTROL_READ_TIMEOUT, 0};
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	char buffer[CONTROL_COMMAND_SIZE];
+	size_t length = 0;
+	while (length < sizeof(buffer) && !memchr(buffer, '\n', length))
+	{
+		ssize_t n = read(connection, buffer + length, sizeof(buffer) - length);
+		if (n <= 0)
+		{
+			break;
+		}
+		length += n;
+	}
+
+	string command(buffer, length);
+	size_t end = command.find_last_not_of(" \t\r\n");
+	command.erase(end == string::npos ? 0 : end + 1);
+
+	string reply = execute(command) + "\n";
+	const char* data = reply.c_str();
+	size_t left = reply.size();
+	while (left)
+	{
+		ssize_t n = write(connection, data, left);
+		if (n <= 0)
+		{
+			break;
+		}
+		data += n;
+		left -= n;
+	}
+}
+
+/**
+ * Execute a command
+ *
+ * @param command	The command line
+ * @return		The reply
+ */
+string ControlSocket::execute(const string& command)
+{
+	istringstream words(command);
+	string verb;
+	words >> verb;
+
+	if (verb == "stats")
+	{
+		return statistics();
+	}
+	if ((verb == "profile" || verb == "capture") && !Instrumentation::sampling)
+	{
+		return "Not available: the filter is built without instrumentation";
+	}
+	if (verb == "profile")
+	{
+		string action;
+		words >> action;
+		if (action == "start")
+		{
+			long rate = 1;
+			if (!(words >> rate) || rate <= 0)
+			{
+				rate = 1;
+			}
+			m_filter->requestProfile(rate);
+			ostringstream reply;
+			reply << "Profiling one batch every " << rate << " from the next batch";
+			return reply.str();
+		}
+		if (action == "stop")
+		{
+			m_filter->requestProfile(0);
+			return "Profiling stopped on the next batch, the profile is logged";
+		}
+		return "Usage: profile start [rate] | profile stop";
+	}
+	if (verb == "capture")
+	{
+		long batches = 0;
+		if (!(words >> batches) || batches <= 0)
+		{
+			return "Usage: capture <batches>";
+		}
+		m_filter->requestCapture(batches);
+		ostringstream reply;
+		reply << "Capturing the next " << batches << " batches to " << m_filter->capturePath();
+		return reply.str();
+	}
+	if (verb == "gc")
+	{
+		return collectGarbage();
+	}
+	return "Commands:\n"
+	       "  stats                  counters of the filter\n"
+	       "  profile start [rate]   profile the script one batch every rate\n"
+	       "  profile stop           stop profiling and log the profile\n"
+	       "  capture <batches>      write the input and output of the next batches\n"
+	       "  gc                     run the Python garbage collector";
+}
+
+/**
+ * Return the counters published by the filter, read
+ * without any call into the ingest thread
+ *
+ * @return	The counters
+ */
+string ControlSocket::statistics()
+{
+	const StatisticsLayout* counters = m_filter->statistics().get();
+	uint64_t batches = counters->batches.load(memory_order_relaxed);
+
+	static const char* stageNames[STAGE_COUNT] = {
+		"GIL wait", "create", "script", "convert", "forward"
+	};
+	ostringstream reply;
+	reply << "batches " << batches
+	      << "\nreadings in " << counters->readingsIn.load(memory_order_relaxed)
+	      << "\nreadings out " << counters->readingsOut.load(memory_order_relaxed)
+	      << "\nerrors " << counters->errors.load(memory_order_relaxed);
+	reply.setf(ios::fixed);
+	reply.precision(1);
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		reply << "\naverage " << stageNames[stage] << " us "
+		      << (batches ? counters->stageTime[stage].load(memory_order_relaxed) / 1e3 / batches : 0.0);
+	}
+	reply << "\nasset tracking queue " << counters->assetTrackingDepth.load(memory_order_relaxed)
+	      << "\nreclaimer queue " << counters->reclaimerDepth.load(memory_order_relaxed)
+	      << "\ncapture pending " << m_filter->captureRemaining();
+	return reply.str();
+}
+
+/**
+ * Run a full collection of the Python garbage collector,
+ * holding the GIL for the collection only
+ *
+ * @return	The reply
+ */
+string ControlSocket::collectGarbage()
+{
+	if (!Py_IsInitialized())
+	{
+		return "Python is not running";
+	}
+
+	PyGILState_STATE state = PyGILState_Ensure();
+	long collected = -1;
+	PyObject* gc = PyImport_ImportModule("gc");
+	if (gc)
+	{
+		PyObject* result = PyObject_CallMethod(gc, (char *)"collect", NULL);
+		if (result)
+		{
+			collected = PyInt_AsLong(result);
+			Py_CLEAR(result);
+		}
+		Py_CLEAR(gc);
+	}
+	if (collected < 0)
+	{
+		PyErr_Clear();
+	}
+	PyGILState_Release(state);
+
+	if (collected < 0)
+	{
+		return "gc.collect() failed";
+	}
+	ostringstream reply;
+	reply << "Collected " << collected << " objects";
+	return reply.str();
+}
@@ -0,0 +1,131 @@
+/*
+ * Fledge "Python 2.7" filter conversion thread pool.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <logger.h>
+
+#include "conversion_pool.h"
+
+using namespace std;
+
+/**
+ * Constructor: start the worker threads
+ *
+ * @param threads	Number of worker threads
+ */
+ConversionPool::ConversionPool(unsigned int threads) :
+				m_work(NULL),
+				m_slices(0),
+				m_nextSlice(0),
+				m_failed(false),
+				m_generation(0),
+				m_active(0),
+				m_running(true)
+{
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		m_threads.push_back(thread(&ConversionPool::worker, this));
+	}
+}
+
+/**
+ * Destructor: stop the worker threads
+ */
+ConversionPool::~ConversionPool()
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_running = false;
+		m_cv.notify_all();
+	}
+	for (auto& t : m_threads)
+	{
+		t.join();
+	}
+}
+
+/**
+ * Run a job made of a number of slices and wait for its completion
+ *
+ * @param slices	Number of slices
+ * @param work		Function processing one slice, given its index
+ * @return		False if any slice has thrown an exception
+ */
+bool ConversionPool::run(unsigned int slices,
+			 const function<void(unsigned int)>& work)
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_work = &work;
+		m_slices = slices;
+		m_nextSlice = 0;
+		m_failed = false;
+		m_active = m_threads.size();
+		m_generation++;
+		m_cv.notify_all();
+	}
+
+	// The caller takes its share of slices
+	process();
+
+	// Wait for the workers to leave the job
+	unique_lock<mutex> lck(m_mutex);
+	m_doneCv.wait(lck, [this] { return m_active == 0; });
+	m_work = NULL;
+
+	return !m_failed;
+}
+
+/**
+ * Process slices of the current job until none is left
+ */
+void ConversionPool::process()
+{
+	unsigned int slice;
+	while ((slice = m_nextSlice.fetch_add(1)) < m_slices)
+	{
+		try
+		{
+			(*m_work)(slice);
+		}
+		catch (exception& e)
+		{
+			m_failed = true;
+			Logger::getLogger()->error("Conversion of readings slice %u failed: %s",
+						   slice,
+						   e.what());
+		}
+	}
+}
+
+/**
+ * Worker thread: wait for jobs
+ */
+void ConversionPool::worker()
+{
+	unsigned long generation = 0;
+	unique_lock<mutex> lck(m_mutex);
+	while (true)
+	{
+		m_cv.wait(lck, [this, generation] { return !m_running ||
+							   m_generation != generation; });
+		if (!m_running)
+		{
+			break;
+		}
+		generation = m_generation;
+
+		lck.unlock();
+		process();
+		lck.lock();
+
+		if (--m_active == 0)
+		{
+			m_doneCv.notify_one();
+		}
+	}
+}
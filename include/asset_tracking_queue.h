@@ -0,0 +1,65 @@
+#ifndef _ASSET_TRACKING_QUEUE_H
+#define _ASSET_TRACKING_QUEUE_H
+/*
+ * Fledge "Python 2.7" filter asset tracking queue.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+/**
+ * AssetTrackingQueue decouples asset tracking from the ingest path.
+ *
+ * New (service, asset, "Filter") tuples are pushed by the ingest thread
+ * onto a lock-free list and registered with the AssetTracker by a
+ * background thread, so plugin_ingest never blocks on the tracker
+ * or on the storage layer behind it.
+ */
+class AssetTrackingQueue
+{
+	public:
+		AssetTrackingQueue(const std::string& service);
+		~AssetTrackingQueue();
+
+		// Called by the ingest thread only
+		void	add(const std::string& assetName);
+		// Number of tuples waiting for the background thread
+		unsigned long
+			depth() const { return m_depth.load(std::memory_order_relaxed); };
+
+	private:
+		struct Tuple
+		{
+			std::string	assetName;
+			Tuple*		next;
+		};
+
+		void	run();
+		void	flush();
+
+	private:
+		// Service name of the tracked tuples
+		std::string		m_service;
+		// Head of the lock-free list of pending tuples
+		std::atomic<Tuple *>	m_head;
+		std::atomic<unsigned long>
+					m_depth;
+		// Assets already queued, accessed by the ingest thread only
+		std::unordered_set<std::string>
+					m_queued;
+		// Last asset seen, avoids hashing runs of the same asset
+		std::string		m_lastAsset;
+		std::atomic<bool>	m_running;
+		std::mutex		m_mutex;
+		std::condition_variable	m_cv;
+		std::thread		m_thread;
+};
+#endif
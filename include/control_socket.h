@@ -0,0 +1,62 @@
+#ifndef _CONTROL_SOCKET_H
+#define _CONTROL_SOCKET_H
+/*
+ * Fledge "Python 2.7" filter control socket.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <string>
+#include <thread>
+
+// Socket directory, relative to FLEDGE_DATA
+#define CONTROL_SOCKET_PATH "/run"
+// Longest command line
+#define CONTROL_COMMAND_SIZE 256
+
+class Python27Filter;
+
+/**
+ * ControlSocket serves runtime diagnostic commands of a filter
+ * instance on a Unix domain socket, from a background thread:
+ * one command line per connection, answered with a text reply.
+ *
+ * Commands are passed to the ingest thread, applied on the next
+ * batch, or run with the GIL held only for their own duration,
+ * without any change to the filter configuration.
+ */
+class ControlSocket
+{
+	public:
+		ControlSocket(Python27Filter* filter,
+			      const std::string& dataDir,
+			      const std::string& filterName);
+		~ControlSocket();
+
+		static std::string
+			socketPath(const std::string& dataDir,
+				   const std::string& filterName);
+
+	private:
+		void	run();
+		void	serve(int connection);
+		std::string
+			execute(const std::string& command);
+		std::string
+			statistics();
+		std::string
+			collectGarbage();
+
+	private:
+		Python27Filter*	m_filter;
+		std::string	m_path;
+		int		m_socket;
+		// Written by the destructor to stop the thread
+		int		m_stop[2];
+		// Not started if the socket can not be created
+		std::thread	m_thread;
+};
+
+#endif
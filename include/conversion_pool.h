@@ -0,0 +1,59 @@
+#ifndef _CONVERSION_POOL_H
+#define _CONVERSION_POOL_H
+/*
+ * Fledge "Python 2.7" filter conversion thread pool.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+/**
+ * ConversionPool is a small fixed size thread pool used to build
+ * Reading objects from the script results in parallel slices.
+ *
+ * run() blocks until all the slices have been processed:
+ * the calling thread processes slices as well.
+ */
+class ConversionPool
+{
+	public:
+		ConversionPool(unsigned int threads);
+		~ConversionPool();
+
+		unsigned int
+			size() const { return m_threads.size(); };
+		bool	run(unsigned int slices,
+			    const std::function<void(unsigned int)>& work);
+
+	private:
+		void	worker();
+		void	process();
+
+	private:
+		std::vector<std::thread>
+					m_threads;
+		std::mutex		m_mutex;
+		std::condition_variable	m_cv;
+		std::condition_variable	m_doneCv;
+		// Current job
+		const std::function<void(unsigned int)>*
+					m_work;
+		unsigned int		m_slices;
+		std::atomic<unsigned int>
+					m_nextSlice;
+		std::atomic<bool>	m_failed;
+		// Job generation, workers wait for a new one
+		unsigned long		m_generation;
+		// Workers still processing the current job
+		unsigned int		m_active;
+		bool			m_running;
+};
+#endif
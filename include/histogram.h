@@ -0,0 +1,108 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+/*
+ * Fledge "Python 2.7" filter histogram.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Power of two buckets: bucket n counts values in [2^(n-1), 2^n)
+#define HISTOGRAM_BUCKETS 40
+
+/**
+ * Histogram with power of two buckets.
+ *
+ * Adding a value costs a count leading zeros and a few increments,
+ * percentiles are reported as the upper bound of their bucket.
+ * Not thread safe: each histogram is updated by one thread.
+ */
+class Histogram
+{
+	public:
+		Histogram() { reset(); };
+
+		void	reset()
+		{
+			memset(m_buckets, 0, sizeof(m_buckets));
+			m_count = 0;
+			m_sum = 0;
+			m_max = 0;
+		};
+		void	add(uint64_t value)
+		{
+			unsigned int bucket = value ? 64 - __builtin_clzll(value) : 0;
+			if (bucket >= HISTOGRAM_BUCKETS)
+			{
+				bucket = HISTOGRAM_BUCKETS - 1;
+			}
+			m_buckets[bucket]++;
+			m_count++;
+			m_sum += value;
+			if (value > m_max)
+			{
+				m_max = value;
+			}
+		};
+		uint64_t
+			count() const { return m_count; };
+		uint64_t
+			sum() const { return m_sum; };
+		uint64_t
+			max() const { return m_max; };
+		double	mean() const { return m_count ? (double)m_sum / m_count : 0.0; };
+
+		/**
+		 * Return the upper bound of the bucket holding a percentile
+		 *
+		 * @param percent	The percentile, 0 to 100
+		 */
+		uint64_t
+			percentile(double percent) const
+		{
+			uint64_t rank = (uint64_t)(m_count * percent / 100.0);
+			uint64_t seen = 0;
+			for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+			{
+				seen += m_buckets[i];
+				if (seen > rank)
+				{
+					uint64_t bound = i ? (1ULL << i) - 1 : 0;
+					return bound < m_max ? bound : m_max;
+				}
+			}
+			return m_max;
+		};
+
+		/**
+		 * Return a one line summary of the histogram
+		 */
+		std::string
+			toString() const
+		{
+			char buffer[160];
+			snprintf(buffer,
+				 sizeof(buffer),
+				 "count %llu, mean %.1f, p50 %llu, p90 %llu, p99 %llu, max %llu",
+				 (unsigned long long)m_count,
+				 mean(),
+				 (unsigned long long)percentile(50),
+				 (unsigned long long)percentile(90),
+				 (unsigned long long)percentile(99),
+				 (unsigned long long)m_max);
+			return std::string(buffer);
+		};
+
+	private:
+		uint64_t	m_buckets[HISTOGRAM_BUCKETS];
+		uint64_t	m_count;
+		uint64_t	m_sum;
+		uint64_t	m_max;
+};
+#endif
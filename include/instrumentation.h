@@ -0,0 +1,98 @@
+#ifndef _INSTRUMENTATION_H
+#define _INSTRUMENTATION_H
+/*
+ * Fledge "Python 2.7" filter ingest instrumentation policy.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+#include "statistics_page.h"
+
+// Instrumentation levels of the ingest path
+#define INSTRUMENTATION_NONE		0	// No counter, no clock read, no sampled diagnostic
+#define INSTRUMENTATION_COUNTERS	1	// Batch, reading and error counters, batch shape,
+						// sampled diagnostics
+#define INSTRUMENTATION_TIMING		2	// Counters, stage times and latencies, data lag
+
+// Selected at build time by the PYTHON27_INSTRUMENTATION CMake option
+#ifndef PYTHON27_INSTRUMENTATION
+#define PYTHON27_INSTRUMENTATION INSTRUMENTATION_TIMING
+#endif
+
+/**
+ * The instrumentation of plugin_ingest, fixed at build time.
+ *
+ * The flags are compile time constants: the instrumentation
+ * code of a disabled level is removed by the compiler, with
+ * no branch left in the ingest path.
+ */
+template<int Level> class InstrumentationPolicy
+{
+	public:
+		static const bool	counters = Level >= INSTRUMENTATION_COUNTERS;
+		static const bool	timing = Level >= INSTRUMENTATION_TIMING;
+		// Candidate script, cost attribution, profile, capture
+		// and script timers, checked on every batch
+		static const bool	sampling = Level >= INSTRUMENTATION_COUNTERS;
+
+		/**
+		 * Add to a statistics counter
+		 *
+		 * @param page		The statistics of the filter
+		 * @param counter	The counter
+		 * @param value		The value to add
+		 */
+		static void	count(StatisticsPage& page,
+				      std::atomic<uint64_t>& counter,
+				      uint64_t value)
+		{
+			if (counters)
+			{
+				page.add(counter, value);
+			}
+		};
+
+		/**
+		 * Set a statistics gauge
+		 *
+		 * @param page		The statistics of the filter
+		 * @param gauge		The gauge
+		 * @param value		The value
+		 */
+		static void	set(StatisticsPage& page,
+				    std::atomic<uint64_t>& gauge,
+				    uint64_t value)
+		{
+			if (counters)
+			{
+				page.set(gauge, value);
+			}
+		};
+
+		/**
+		 * Return the current time of the monotonic clock,
+		 * 0 without timing
+		 *
+		 * @return	Nanoseconds
+		 */
+		static uint64_t	now()
+		{
+			if (!timing)
+			{
+				return 0;
+			}
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+		};
+};
+
+typedef InstrumentationPolicy<PYTHON27_INSTRUMENTATION> Instrumentation;
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+/*
+ * Fledge "Python 2.7" filter hardware performance counters.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+
+#include "statistics_page.h"
+
+/**
+ * Hardware events counted for each ingest stage
+ */
+typedef enum
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_EVENT_COUNT
+} PerfEvent;
+
+/**
+ * PerfCounters counts hardware events of the ingest thread with
+ * perf_event_open and attributes them to the ingest stages.
+ *
+ * Counters are opened on the first start() call, by the thread
+ * that calls it, and opened again if the ingest thread changes.
+ * If the kernel does not allow them, all calls are no-ops.
+ */
+class PerfCounters
+{
+	public:
+		PerfCounters();
+		~PerfCounters();
+
+		void	start();
+		void	stop(IngestStage stage);
+		bool	available() const { return !m_failed; };
+		std::string
+			report(IngestStage stage) const;
+
+	private:
+		bool	open();
+		void	close();
+		bool	read(uint64_t* values);
+
+	private:
+		int		m_fd[PERF_EVENT_COUNT];
+		uint64_t	m_id[PERF_EVENT_COUNT];
+		// Thread the counters are attached to
+		pid_t		m_tid;
+		bool		m_failed;
+		bool		m_started;
+		uint64_t	m_start[PERF_EVENT_COUNT];
+		// Event totals and measurements of each stage
+		uint64_t	m_totals[STAGE_COUNT][PERF_EVENT_COUNT];
+		uint64_t	m_samples[STAGE_COUNT];
+};
+#endif
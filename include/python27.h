@@ -11,12 +11,25 @@
  */
 
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <time.h>
 
 #include <filter_plugin.h>
 #include <filter.h>
 
 #include <Python.h>
 
+#include "conversion_pool.h"
+#include "statistics_page.h"
+#include "instrumentation.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "trace_buffer.h"
+#include "script_profiler.h"
+#include "script_timers.h"
+#include "control_socket.h"
+
 // Relative path to FLEDGE_DATA
 #define PYTHON_FILTERS_PATH "/scripts"
 
@@ -35,17 +48,70 @@ class Python27Filter : public FledgeFilter
 			       FledgeFilter(name,
 					config,
 					outHandle,
-					output)
+					output),
+			       m_statistics(config.getName()),
+			       m_categoryName(config.getName())
 		{
 			m_pModule = NULL;
 			m_pFunc = NULL;
+			m_outputMode = OUTPUT_REPLACE;
+			m_keyReading = NULL;
+			m_keyAssetCode = NULL;
+			m_keyId = NULL;
+			m_keyTs = NULL;
+			m_keyUserTs = NULL;
+			m_namePoolLookups = 0;
+			m_namePoolHits = 0;
+			m_lastStatistics = time(NULL);
+			m_conversionPool = NULL;
+			m_warmup = false;
+			m_shadowModule = NULL;
+			m_shadowFunc = NULL;
+			m_shadowRate = 0;
+			m_shadowCounter = 0;
+			m_shadowPromote = false;
+			m_attributionRate = 0;
+			m_attributionCounter = 0;
+			m_perfCounters = NULL;
+			m_perfRequested = false;
+			m_trace = false;
+			memset(m_batchShape.values, 0, sizeof(m_batchShape.values));
+			m_profiler = NULL;
+			m_profileRate = 0;
+			m_profileCounter = 0;
+			m_control = NULL;
+			m_profileRequest = -1;
+			m_profileReset = false;
+			m_captureRemaining = 0;
+			m_captureBatches = 0;
+		};
+		~Python27Filter()
+		{
+			delete m_conversionPool;
+			delete m_perfCounters;
+			delete m_profiler;
+			delete m_control;
+			for (std::vector<Reading *>::iterator it = m_warmupSample.begin();
+							      it != m_warmupSample.end();
+							      ++it)
+			{
+				delete *it;
+			}
 		};
 
+		// How the script results are passed onwards
+		typedef enum {
+			OUTPUT_REPLACE,		// New ReadingSet
+			OUTPUT_IN_PLACE,	// Input ReadingSet updated
+			OUTPUT_APPEND		// Script readings added to input
+		} OutputMode;
+
 		// Set the additional path for Python3.5 Fledge scripts
 		void	setFiltersPath(const std::string& dataDir)
 		{
 			// Set Fledge dataDir + filters dir
 			m_filtersPath = dataDir + PYTHON_FILTERS_PATH;
+			m_dataDir = dataDir;
 		}
 		const std::string&
 			getFiltersPath() const { return m_filtersPath; };
@@ -57,9 +123,145 @@ class Python27Filter : public FledgeFilter
 		void	logErrorMessage();
 		// Filtering methods for Reading objects
 		PyObject*
-			createReadingsList(const std::vector<Reading *>& readings);
+			createReadingsList(const std::vector<Reading *>& readings,
+					   bool recordShape = false);
 		std::vector<Reading *>*
 			getFilteredReadings(PyObject* filteredData);
+		bool	updateReadings(PyObject* filteredData,
+				       PyObject* inputData,
+				       ReadingSet* readingSet);
+		bool	appendReadings(PyObject* filteredData,
+				       ReadingSet* readingSet,
+				       std::vector<Reading *>& added);
+		OutputMode
+			getOutputMode() const { return m_outputMode; };
+		void	clearObjectCache();
+		void	captureWarmupSample(const std::vector<Reading *>& readings);
+		// Shadow execution of a candidate script
+		bool	shadowSample();
+		void	runShadow(PyObject* input,
+				  PyObject* primaryResult,
+				  long primaryTime);
+		void	clearShadow();
+		// Per asset cost attribution
+		bool	attributionSample();
+		void	runAttribution(PyObject* input);
+		// Statistics reporting
+		StatisticsPage&
+			statistics() { return m_statistics; };
+		void	recordStartup(StartupPhase phase,
+				      uint64_t start,
+				      uint64_t end)
+		{
+			m_statistics.set(m_statistics->startupTime[phase], end - start);
+		};
+		void	recordStage(IngestStage stage,
+				    uint64_t start,
+				    uint64_t end,
+				    unsigned long readings)
+		{
+			if (!Instrumentation::timing)
+			{
+				return;
+			}
+			m_statistics.add(m_statistics->stageTime[stage], end - start);
+			m_stageLatency[stage].add((end - start) / 1000);
+			if (m_trace)
+			{
+				TraceBuffer::getInstance()->add(&m_categoryName,
+								stage,
+								start,
+								end,
+								readings);
+			}
+		};
+		void	flushTrace();
+		// Function profile of the script on sampled batches
+		ScriptProfiler*
+			profileStart();
+		void	profileStop(ScriptProfiler* profiler) { profiler->stop(); };
+		// Release the code objects of the profile, with the GIL held
+		void	clearProfile() { delete m_profiler; m_profiler = NULL; };
+		// Requests of the control socket, applied by the ingest thread
+		void	stopControl();
+		void	requestProfile(long rate)
+		{
+			m_profileRequest.store(rate, std::memory_order_relaxed);
+		};
+		void	requestCapture(unsigned long batches)
+		{
+			m_captureRemaining.store(batches, std::memory_order_relaxed);
+		};
+		unsigned long
+			captureRemaining() const
+		{
+			return m_captureRemaining.load(std::memory_order_relaxed);
+		};
+		const std::string&
+			capturePath() const { return m_capturePath; };
+		void	applyControl()
+		{
+			if (m_profileRequest.load(std::memory_order_relaxed) >= 0)
+			{
+				this->applyProfileRequest();
+			}
+		};
+		bool	captureSample()
+		{
+			unsigned long remaining = m_captureRemaining.load(std::memory_order_relaxed);
+			// A new request replaces the remaining count
+			return remaining &&
+			       m_captureRemaining.compare_exchange_strong(remaining, remaining - 1);
+		};
+		std::string
+			captureJson(PyObject* object);
+		void	writeCapture(const std::string& input, PyObject* output);
+		// Sections timed by the script
+		ScriptTimers&
+			scriptTimers() { return m_scriptTimers; };
+		// Hardware counters of the ingest stages, if enabled
+		void	applyPerfCounters()
+		{
+			if (!Instrumentation::timing)
+			{
+				return;
+			}
+			bool requested = m_perfRequested.load(std::memory_order_relaxed);
+			if (requested && !m_perfCounters)
+			{
+				m_perfCounters = new PerfCounters();
+			}
+			else if (!requested && m_perfCounters)
+			{
+				delete m_perfCounters;
+				m_perfCounters = NULL;
+			}
+		};
+		void	perfStart()
+		{
+			if (Instrumentation::timing && m_perfCounters)
+			{
+				m_perfCounters->start();
+			}
+		};
+		void	perfStop(IngestStage stage)
+		{
+			if (Instrumentation::timing && m_perfCounters)
+			{
+				m_perfCounters->stop(stage);
+			}
+		};
+		void	recordFreshness(const std::vector<Reading *>& readings);
+		void	recordOutputRatio(unsigned long readingsIn,
+					  unsigned long readingsOut)
+		{
+			if (Instrumentation::counters && readingsIn)
+			{
+				m_batchShape.outputRatio.add(readingsOut * 100 / readingsIn);
+			}
+		};
+		void	reportStatistics();
+		void	logStatistics();
 
 	public:
 		// Python 3.5 loaded filter module handle
@@ -68,10 +270,168 @@ class Python27Filter : public FledgeFilter
 		PyObject*	m_pFunc;
 		// Python 3.5  script name
 		std::string	m_pythonScript;
+		// Candidate script module and method handles
+		PyObject*	m_shadowModule;
+		PyObject*	m_shadowFunc;
+		std::string	m_shadowScript;
+
+	private:
+		bool	checkFilteredReadings(PyObject* filteredData);
+		bool	updateReading(Reading* reading, PyObject* element);
+		Reading*
+			createReading(PyObject* element);
+		std::vector<Reading *>*
+			getFilteredReadingsParallel(PyObject* filteredData);
+		PyObject*
+			createWarmupBatch();
+		void	warmUp();
+		bool	setModuleConfig(PyObject* module,
+					const std::string& configuration);
+		void	configureShadow(const std::string& filterMethod,
+					const std::string& configuration);
+		void	logAssetCosts();
+		void	logFreshness();
+		void	logBatchShape();
+		void	logProfile();
+		void	applyProfileRequest();
+		PyObject*
+			getNameObject(const std::string& name);
+		PyObject*
+			getTimestampObject(unsigned long ts);
+		void	clearTimestampObjects();
+		void	clearNameObjects();
+		const std::string*
+			getPooledName(PyObject* name);
+		void	trimNamePool();
+		void	clearNamePool();
 
 	private:
+		// Output mode
+		OutputMode	m_outputMode;
+		// Interned asset and datapoint names, kept across batches
+		std::unordered_map<std::string, PyObject *>
+				m_nameObjects;
+		// Timestamp objects of the batch being created
+		std::unordered_map<unsigned long, PyObject *>
+				m_timestampObjects;
+		// Interned dict keys of each reading
+		PyObject*	m_keyReading;
+		PyObject*	m_keyAssetCode;
+		PyObject*	m_keyId;
+		PyObject*	m_keyTs;
+		PyObject*	m_keyUserTs;
+		// Canonical names returned by the script, by Python object
+		std::unordered_map<PyObject *, std::string>
+				m_namePool;
+		unsigned long	m_namePoolLookups;
+		unsigned long	m_namePoolHits;
+		// Threads of the parallel conversion of large results
+		ConversionPool*	m_conversionPool;
+		// Held while the pool runs without the GIL
+		std::mutex	m_conversionMutex;
+		// Warm-up of the script after configuration
+		bool		m_warmup;
+		std::string	m_warmupData;
+		// One reading per asset, schema of the warm-up batches
+		std::vector<Reading *>
+				m_warmupSample;
+		// Candidate script sampling and comparison
+		typedef struct ShadowStatistics
+		{
+			ShadowStatistics() : batches(0),
+					     primaryTime(0),
+					     candidateTime(0),
+					     primaryErrors(0),
+					     candidateErrors(0),
+					     differentBatches(0),
+					     differentReadings(0) {};
+			unsigned long	batches;
+			unsigned long	primaryTime;
+			unsigned long	candidateTime;
+			unsigned long	primaryErrors;
+			unsigned long	candidateErrors;
+			unsigned long	differentBatches;
+			unsigned long	differentReadings;
+		} ShadowStatistics;
+		unsigned long	m_shadowRate;
+		unsigned long	m_shadowCounter;
+		bool		m_shadowPromote;
+		ShadowStatistics
+				m_shadowStats;
+		// Script execution cost of each asset on sampled batches
+		typedef struct AssetCost
+		{
+			AssetCost() : batches(0), readings(0), time(0) {};
+			unsigned long	batches;
+			unsigned long	readings;
+			// Nanoseconds
+			uint64_t	time;
+		} AssetCost;
+		unsigned long	m_attributionRate;
+		unsigned long	m_attributionCounter;
+		std::unordered_map<std::string, AssetCost>
+				m_assetCosts;
+		// Counters published in shared memory
+		StatisticsPage	m_statistics;
+		// Latency of each ingest stage, in microseconds
+		Histogram	m_stageLatency[STAGE_COUNT];
+		// Shape of the input batches, for capacity planning
+		typedef enum
+		{
+			VALUE_INTEGER,
+			VALUE_FLOAT,
+			VALUE_STRING,
+			VALUE_OTHER,
+			VALUE_TYPES
+		} ValueType;
+		typedef struct
+		{
+			Histogram	readings;	// Readings per batch
+			Histogram	datapoints;	// Datapoints per reading
+			Histogram	stringSize;	// Bytes of string values
+			uint64_t	values[VALUE_TYPES];
+			// Output readings per 100 input readings of each batch
+			Histogram	outputRatio;
+		} BatchShape;
+		BatchShape	m_batchShape;
+		// Lag between user_ts and forward time of the output readings,
+		// in milliseconds, of the filter and of each asset
+		Histogram	m_freshness;
+		std::unordered_map<std::string, Histogram>
+				m_assetFreshness;
+		// Hardware counters, created and deleted by the ingest
+		// thread as the configuration requests
+		PerfCounters*	m_perfCounters;
+		std::atomic<bool>
+				m_perfRequested;
+		// Category name given to plugin_init: a new configuration
+		// is named after the plugin. Names the trace spans and the
+		// control socket.
+		std::string	m_categoryName;
+		// Ingest spans added to the process trace buffer
+		bool		m_trace;
+		ScriptProfiler*	m_profiler;
+		unsigned long	m_profileRate;
+		unsigned long	m_profileCounter;
+		ScriptTimers	m_scriptTimers;
+		// Runtime diagnostic commands
+		ControlSocket*	m_control;
+		// Requested profile rate, 0 to stop, -1 if none
+		std::atomic<long>
+				m_profileRequest;
+		// Profile to reset with the request, the script has been
+		// loaded again. Guarded by the GIL.
+		bool		m_profileReset;
+		// Batches to capture and file of the captured batches
+		std::atomic<unsigned long>
+				m_captureRemaining;
+		unsigned long	m_captureBatches;
+		std::string	m_capturePath;
+		// Time of last statistics report
+		time_t		m_lastStatistics;
 		// Scripts path
 		std::string	m_filtersPath;
+		std::string	m_dataDir;
 		// Configuration lock
 		std::mutex	m_configMutex;
 };
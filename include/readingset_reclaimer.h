@@ -0,0 +1,61 @@
+#ifndef _READINGSET_RECLAIMER_H
+#define _READINGSET_RECLAIMER_H
+/*
+ * Fledge "Python 2.7" filter deferred ReadingSet reclamation.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include <reading_set.h>
+
+/**
+ * ReadingSetReclaimer destroys consumed ReadingSets on a low priority
+ * background thread, taking the destructor cost of large batches
+ * off the ingest path.
+ *
+ * A single instance is shared by all the python27 filters in
+ * the process: it is created by the first acquire() and
+ * the thread is stopped by the last release().
+ */
+class ReadingSetReclaimer
+{
+	public:
+		static ReadingSetReclaimer*
+			acquire();
+		static void
+			release();
+
+		void	reclaim(ReadingSet* readingSet);
+		// Number of ReadingSets waiting to be destroyed
+		unsigned long
+			depth() const { return m_depth.load(std::memory_order_relaxed); };
+
+	private:
+		ReadingSetReclaimer();
+		~ReadingSetReclaimer();
+		void	run();
+
+	private:
+		static ReadingSetReclaimer*
+					m_instance;
+		static unsigned int	m_users;
+		static std::mutex	m_instanceMutex;
+
+		std::deque<ReadingSet *>
+					m_queue;
+		std::atomic<unsigned long>
+					m_depth;
+		bool			m_running;
+		std::mutex		m_mutex;
+		std::condition_variable	m_cv;
+		std::thread		m_thread;
+};
+#endif
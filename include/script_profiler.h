@@ -0,0 +1,88 @@
+#ifndef _SCRIPT_PROFILER_H
+#define _SCRIPT_PROFILER_H
+/*
+ * Fledge "Python 2.7" filter script function profiler.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <Python.h>
+#include <frameobject.h>
+
+// Functions listed in a profile report
+#define PROFILE_REPORT_FUNCTIONS 20
+
+/**
+ * ScriptProfiler counts the calls and the time of each Python
+ * and built-in function called by the filter script, using the
+ * interpreter profile hook of the ingest thread.
+ *
+ * The hook is only installed between start() and stop(), so that
+ * calls outside the profiled batches run at full speed.
+ * Python functions are identified by their code object, referenced
+ * by the profiler so that its address is not reused by another one,
+ * and built-in functions by their method definition, which lives as
+ * long as its module. The profiler is reset when the script is
+ * reloaded; it must be reset and deleted with the GIL held.
+ */
+class ScriptProfiler
+{
+	public:
+		ScriptProfiler();
+		~ScriptProfiler();
+
+		void	start();
+		void	stop();
+		void	reset();
+		unsigned long
+			batches() const { return m_batches; };
+		std::string
+			report(unsigned int functions) const;
+
+	private:
+		typedef struct
+		{
+			std::string	name;
+			// Code object of a Python function, NULL for built-ins
+			PyObject*	code;
+			uint64_t	calls;
+			// Nanoseconds, including and excluding called functions
+			uint64_t	inclusive;
+			uint64_t	exclusive;
+			// Calls of this function on the stack, for recursion
+			unsigned int	active;
+		} FunctionStatistics;
+
+		typedef struct
+		{
+			FunctionStatistics*
+					function;
+			uint64_t	start;
+			// Time of the functions called by this one
+			uint64_t	children;
+		} StackFrame;
+
+		static int
+			profile(PyObject* object,
+				PyFrameObject* frame,
+				int what,
+				PyObject* arg);
+		void	enter(const void* key, PyFrameObject* frame, PyObject* function);
+		void	leave();
+		void	release();
+
+	private:
+		std::unordered_map<const void*, FunctionStatistics>
+				m_functions;
+		std::vector<StackFrame>
+				m_stack;
+		unsigned long	m_batches;
+};
+#endif
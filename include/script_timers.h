@@ -0,0 +1,64 @@
+#ifndef _SCRIPT_TIMERS_H
+#define _SCRIPT_TIMERS_H
+/*
+ * Fledge "Python 2.7" filter script timers.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <string>
+#include <unordered_map>
+
+#include <Python.h>
+
+#include "histogram.h"
+
+// Python module with the timer API for filter scripts
+#define SCRIPT_TIMERS_MODULE "fledge_timing"
+// Timer names kept for each filter, others are ignored
+#define SCRIPT_TIMERS_MAX_NAMES 256
+
+/**
+ * ScriptTimers keeps the histograms of the sections a filter
+ * script times with the native fledge_timing module:
+ *
+ *	import fledge_timing
+ *
+ *	with fledge_timing.timed("lookup"):
+ *		...
+ *
+ * Timer names are interned strings used as keys, so recording
+ * a section costs two clock reads and a pointer hash lookup.
+ * Sections are recorded into the timers of the filter whose
+ * script is running on the calling thread, see activate().
+ */
+class ScriptTimers
+{
+	public:
+		ScriptTimers() {};
+
+		static void
+			initModule();
+		static void
+			activate(ScriptTimers* timers);
+
+		void	record(PyObject* name, uint64_t nanoseconds);
+		void	clear();
+
+		typedef struct
+		{
+			std::string	name;
+			Histogram	histogram;
+		} Timer;
+
+		const std::unordered_map<PyObject*, Timer>&
+			timers() const { return m_timers; };
+
+	private:
+		// Interned name, with a reference held, and its histogram
+		std::unordered_map<PyObject*, Timer>
+				m_timers;
+};
+#endif
@@ -0,0 +1,126 @@
+#ifndef _STATISTICS_PAGE_H
+#define _STATISTICS_PAGE_H
+/*
+ * Fledge "Python 2.7" filter shared memory statistics.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+// Shared memory segment name prefix, followed by the filter category name
+#define STATISTICS_PAGE_PREFIX "/fledge-python27-"
+// Layout identification: "PY27" and layout version
+#define STATISTICS_PAGE_MAGIC 0x50593237
+#define STATISTICS_PAGE_VERSION 1
+
+/**
+ * Ingest stages timed by the filter
+ */
+typedef enum
+{
+	STAGE_GIL_WAIT,		// Wait for the Python GIL
+	STAGE_CREATE,		// createReadingsList
+	STAGE_SCRIPT,		// Python filter method call
+	STAGE_CONVERT,		// Conversion of the script result
+	STAGE_FORWARD,		// Next filter in the pipeline
+	STAGE_COUNT
+} IngestStage;
+
+/**
+ * Phases of plugin_init timed by the filter
+ */
+typedef enum
+{
+	STARTUP_INTERPRETER,	// Python interpreter initialisation
+	STARTUP_PATH,		// sys.path, timing module and script name
+	STARTUP_IMPORT,		// Import of the script
+	STARTUP_CONFIG,		// set_filter_config call
+	STARTUP_COUNT
+} StartupPhase;
+
+/**
+ * Layout of the statistics segment.
+ *
+ * Counters are written with relaxed atomics by the ingest thread
+ * and read by external monitoring tools: new fields can only be
+ * appended, any other change needs a new STATISTICS_PAGE_VERSION.
+ */
+typedef struct
+{
+	uint32_t		magic;
+	uint32_t		version;
+	// Size of this structure, as written by the filter
+	uint32_t		size;
+	uint32_t		pid;
+	char			filterName[128];
+	std::atomic<uint64_t>	batches;
+	std::atomic<uint64_t>	readingsIn;
+	std::atomic<uint64_t>	readingsOut;
+	std::atomic<uint64_t>	errors;
+	// Nanoseconds spent in each IngestStage
+	std::atomic<uint64_t>	stageTime[STAGE_COUNT];
+	// Pending asset tracking tuples and ReadingSets to destroy
+	std::atomic<uint64_t>	assetTrackingDepth;
+	std::atomic<uint64_t>	reclaimerDepth;
+	// Nanoseconds spent in each StartupPhase, import and
+	// set_filter_config are updated by a reconfiguration
+	std::atomic<uint64_t>	startupTime[STARTUP_COUNT];
+} StatisticsLayout;
+
+/**
+ * StatisticsPage publishes the counters of a filter instance
+ * in a named POSIX shared memory segment, so that they can be
+ * monitored without any call into the ingest thread.
+ *
+ * If the segment can not be created the counters are kept
+ * in process memory only.
+ */
+class StatisticsPage
+{
+	public:
+		StatisticsPage(const std::string& filterName);
+		~StatisticsPage();
+
+		StatisticsLayout*
+			operator->() { return m_layout; };
+		const StatisticsLayout*
+			get() const { return m_layout; };
+		void	add(std::atomic<uint64_t>& counter, uint64_t value)
+		{
+			counter.fetch_add(value, std::memory_order_relaxed);
+		};
+		void	set(std::atomic<uint64_t>& counter, uint64_t value)
+		{
+			counter.store(value, std::memory_order_relaxed);
+		};
+
+		/**
+		 * Return the shared memory segment name of a filter,
+		 * '/' and blanks are not allowed in segment names
+		 *
+		 * @param filterName	The filter category name
+		 */
+		static std::string
+			segmentName(const std::string& filterName)
+		{
+			std::string name = STATISTICS_PAGE_PREFIX;
+			for (std::string::const_iterator c = filterName.begin();
+							 c != filterName.end();
+							 ++c)
+			{
+				name += (*c == '/' || *c == ' ') ? '_' : *c;
+			}
+			return name;
+		};
+
+	private:
+		std::string		m_name;
+		StatisticsLayout*	m_layout;
+		bool			m_shared;
+};
+#endif
@@ -0,0 +1,90 @@
+#ifndef _TRACE_BUFFER_H
+#define _TRACE_BUFFER_H
+/*
+ * Fledge "Python 2.7" filter ingest span tracing.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "statistics_page.h"
+
+// Relative path to FLEDGE_DATA of the trace files
+#define TRACE_FILES_PATH "/logs/python27"
+// Spans kept in memory before they are written to a file
+#define TRACE_BUFFER_SPANS 65536
+// Full buffers waiting for the writer thread, others are dropped
+#define TRACE_PENDING_BUFFERS 4
+
+/**
+ * One ingest stage of a batch
+ */
+typedef struct
+{
+	// Filter category name, owned by the filter
+	const std::string*	filterName;
+	IngestStage		stage;
+	long			tid;
+	// Monotonic clock nanoseconds
+	uint64_t		start;
+	uint64_t		duration;
+	unsigned long		readings;
+} TraceSpan;
+
+/**
+ * TraceBuffer collects the ingest spans of all the python27 filters
+ * of the process that have tracing enabled, so that filters and
+ * ingest threads can be seen interleaved in one timeline.
+ *
+ * Spans are kept in a bounded buffer and written as a Chrome
+ * trace-event JSON file, viewable with Perfetto or chrome://tracing,
+ * when the buffer is full and when a traced filter is removed.
+ * Files are written by a background thread: the ingest threads only
+ * hand the full buffer over.
+ */
+class TraceBuffer
+{
+	public:
+		static TraceBuffer*
+			getInstance();
+
+		void	setDataDir(const std::string& dataDir);
+		void	add(const std::string* filterName,
+			    IngestStage stage,
+			    uint64_t start,
+			    uint64_t end,
+			    unsigned long readings);
+		void	flush();
+
+	private:
+		TraceBuffer();
+		~TraceBuffer();
+		void	pend();
+		void	run();
+		void	write(const std::string& dataDir,
+			      const std::vector<TraceSpan>& spans);
+
+	private:
+		std::mutex		m_mutex;
+		std::vector<TraceSpan>	m_spans;
+		std::string		m_dataDir;
+		// Full buffers to write, and the one being written
+		std::deque<std::vector<TraceSpan> >
+					m_pending;
+		unsigned long		m_dropped;
+		bool			m_stop;
+		std::condition_variable	m_condition;
+		std::thread		m_writer;
+		// Only used by the writer thread
+		unsigned int		m_files;
+};
+#endif
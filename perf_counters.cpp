@@ -0,0 +1,223 @@
+/*
+ * Fledge "Python 2.7" filter hardware performance counters.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <logger.h>
+
+#include "perf_counters.h"
+
+using namespace std;
+
+// Hardware event of each PerfEvent
+static const uint64_t perfEventConfig[PERF_EVENT_COUNT] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/**
+ * Constructor: counters are opened by the first start()
+ */
+PerfCounters::PerfCounters() : m_tid(0),
+			       m_failed(false),
+			       m_started(false)
+{
+	for (int i = 0; i < PERF_EVENT_COUNT; i++)
+	{
+		m_fd[i] = -1;
+		m_id[i] = 0;
+	}
+	memset(m_totals, 0, sizeof(m_totals));
+	memset(m_samples, 0, sizeof(m_samples));
+}
+
+/**
+ * Destructor: close the counters
+ */
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+/**
+ * Open the counters of the calling thread as one group,
+ * led by the cycles counter. Events the CPU does not
+ * support are left out of the group.
+ *
+ * @return	False if the counters are not available
+ */
+bool PerfCounters::open()
+{
+	close();
+	m_tid = syscall(SYS_gettid);
+
+	for (int i = 0; i < PERF_EVENT_COUNT; i++)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = perfEventConfig[i];
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.disabled = (i == PERF_CYCLES);
+
+		m_fd[i] = syscall(__NR_perf_event_open,
+				  &attr,
+				  0,		// calling thread
+				  -1,		// any CPU
+				  i == PERF_CYCLES ? -1 : m_fd[PERF_CYCLES],
+				  0);
+		if (m_fd[i] < 0)
+		{
+			if (i == PERF_CYCLES)
+			{
+				Logger::getLogger()->warn("Hardware performance counters "
+							  "are not available: %s",
+							  strerror(errno));
+				return false;
+			}
+			continue;
+		}
+		ioctl(m_fd[i], PERF_EVENT_IOC_ID, &m_id[i]);
+	}
+
+	ioctl(m_fd[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_fd[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	return true;
+}
+
+/**
+ * Close the counters
+ */
+void PerfCounters::close()
+{
+	for (int i = 0; i < PERF_EVENT_COUNT; i++)
+	{
+		if (m_fd[i] >= 0)
+		{
+			::close(m_fd[i]);
+			m_fd[i] = -1;
+		}
+	}
+}
+
+/**
+ * Read the current value of all the events
+ *
+ * @param values	Event values, 0 for the events not counted
+ * @return		False on read error
+ */
+bool PerfCounters::read(uint64_t* values)
+{
+	// Group read format: nr, then value and id of each event
+	uint64_t buffer[1 + 2 * PERF_EVENT_COUNT];
+	if (::read(m_fd[PERF_CYCLES], buffer, sizeof(buffer)) <= 0)
+	{
+		return false;
+	}
+
+	memset(values, 0, sizeof(uint64_t) * PERF_EVENT_COUNT);
+	for (uint64_t n = 0; n < buffer[0] && n < PERF_EVENT_COUNT; n++)
+	{
+		for (int i = 0; i < PERF_EVENT_COUNT; i++)
+		{
+			if (m_fd[i] >= 0 && m_id[i] == buffer[2 + 2 * n])
+			{
+				values[i] = buffer[1 + 2 * n];
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Start the measurement of a stage
+ */
+void PerfCounters::start()
+{
+	m_started = false;
+	if (m_failed)
+	{
+		return;
+	}
+
+	if (m_fd[PERF_CYCLES] < 0 || m_tid != syscall(SYS_gettid))
+	{
+		if (!open())
+		{
+			m_failed = true;
+			close();
+			return;
+		}
+	}
+
+	m_started = read(m_start);
+}
+
+/**
+ * End the measurement of a stage and add the
+ * counted events to the stage totals
+ *
+ * @param stage		The ingest stage
+ */
+void PerfCounters::stop(IngestStage stage)
+{
+	uint64_t values[PERF_EVENT_COUNT];
+	if (!m_started || !read(values))
+	{
+		return;
+	}
+	m_started = false;
+
+	for (int i = 0; i < PERF_EVENT_COUNT; i++)
+	{
+		m_totals[stage][i] += values[i] - m_start[i];
+	}
+	m_samples[stage]++;
+}
+
+/**
+ * Return the average events of a stage
+ *
+ * @param stage		The ingest stage
+ * @return		One line report, empty if
+ *			the stage has not been measured
+ */
+string PerfCounters::report(IngestStage stage) const
+{
+	uint64_t samples = m_samples[stage];
+	if (!samples)
+	{
+		return string();
+	}
+
+	const uint64_t* totals = m_totals[stage];
+	char buffer[200];
+	snprintf(buffer,
+		 sizeof(buffer),
+		 "cycles %.0f, instructions %.0f (IPC %.2f), cache misses %.0f, branch misses %.0f",
+		 (double)totals[PERF_CYCLES] / samples,
+		 (double)totals[PERF_INSTRUCTIONS] / samples,
+		 totals[PERF_CYCLES] ?
+		 (double)totals[PERF_INSTRUCTIONS] / totals[PERF_CYCLES] :
+		 0.0,
+		 (double)totals[PERF_CACHE_MISSES] / samples,
+		 (double)totals[PERF_BRANCH_MISSES] / samples);
+	return string(buffer);
+}
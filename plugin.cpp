@@ -8,10 +8,13 @@
  * Author: Massimiliano Pinto
  */
 
+#include <time.h>
 #include <utils.h>
 #include <version.h>
 
 #include "python27.h"
+#include "asset_tracking_queue.h"
+#include "readingset_reclaimer.h"
 
 // Relative path to FLEDGE_DATA
 #define PYTHON_FILTERS_PATH "/scripts"
@@ -65,15 +68,114 @@
 				"\"type\": \"script\", " \
 				"\"displayName\" : \"Python Script\", " \
 				"\"order\": \"1\", " \
-				"\"default\": \"""\"} }"
+				"\"default\": \"""\"}, " \
+			"\"outputMode\" : {\"description\" : \"Pass onwards a new set of readings built from " \
+					"the script result, update the input readings in place or " \
+					"append the readings returned by the script to the input readings.\", " \
+				"\"type\": \"enumeration\", " \
+				"\"options\": [\"Replace\", \"Update in place\", \"Append\"], " \
+				"\"displayName\" : \"Output Mode\", " \
+				"\"order\": \"3\", " \
+				"\"default\": \"Replace\"}, " \
+			"\"conversionThreads\" : {\"description\" : \"Number of threads used to convert " \
+					"large script results into readings, 0 disables the parallel conversion.\", " \
+				"\"type\": \"integer\", " \
+				"\"displayName\" : \"Conversion Threads\", " \
+				"\"minimum\": \"0\", " \
+				"\"maximum\": \"16\", " \
+				"\"order\": \"4\", " \
+				"\"default\": \"0\"}, " \
+			"\"warmup\" : {\"description\" : \"Call the script with synthetic readings after " \
+					"it has been loaded, so that live data does not pay for its first calls.\", " \
+				"\"type\": \"boolean\", " \
+				"\"displayName\" : \"Warm Up Script\", " \
+				"\"order\": \"5\", " \
+				"\"default\": \"false\"}, " \
+			"\"warmupData\" : {\"description\" : \"Readings used to warm up the script, " \
+					"as a JSON array of objects with asset_code and reading. " \
+					"If empty the readings recently processed are used.\", " \
+				"\"type\": \"JSON\", " \
+				"\"displayName\" : \"Warm Up Readings\", " \
+				"\"order\": \"6\", " \
+				"\"validity\": \"warmup == \\\"true\\\"\", " \
+				"\"default\": \"[]\"}, " \
+			"\"shadowScript\" : {\"description\" : \"Candidate Python 2.7 module, in the scripts " \
+					"directory, run on sampled readings to be compared with the current script.\", " \
+				"\"type\": \"string\", " \
+				"\"displayName\" : \"Candidate Script\", " \
+				"\"order\": \"7\", " \
+				"\"default\": \"\"}, " \
+			"\"shadowRate\" : {\"description\" : \"Run the candidate script on one batch of " \
+					"readings every N, 0 disables the candidate script.\", " \
+				"\"type\": \"integer\", " \
+				"\"displayName\" : \"Candidate Sample Rate\", " \
+				"\"minimum\": \"0\", " \
+				"\"order\": \"8\", " \
+				"\"default\": \"10\"}, " \
+			"\"shadowPromote\" : {\"description\" : \"Use the candidate script in place of " \
+					"the current script.\", " \
+				"\"type\": \"boolean\", " \
+				"\"displayName\" : \"Promote Candidate Script\", " \
+				"\"order\": \"9\", " \
+				"\"default\": \"false\"}, " \
+			"\"attributionRate\" : {\"description\" : \"Time the script separately for each " \
+					"asset on one batch of readings every N and log the most expensive assets, " \
+					"0 disables the cost attribution.\", " \
+				"\"type\": \"integer\", " \
+				"\"displayName\" : \"Asset Cost Sample Rate\", " \
+				"\"minimum\": \"0\", " \
+				"\"order\": \"10\", " \
+				"\"default\": \"0\"}, " \
+			"\"perfCounters\" : {\"description\" : \"Count CPU cycles, instructions, cache misses " \
+					"and branch misses of each ingest stage and log them with the filter statistics.\", " \
+				"\"type\": \"boolean\", " \
+				"\"displayName\" : \"Hardware Counters\", " \
+				"\"order\": \"11\", " \
+				"\"default\": \"false\"}, " \
+			"\"trace\" : {\"description\" : \"Record the timing of each ingest stage of every " \
+					"batch and write it as a Chrome trace file in the Fledge logs directory.\", " \
+				"\"type\": \"boolean\", " \
+				"\"displayName\" : \"Trace Ingest\", " \
+				"\"order\": \"12\", " \
+				"\"default\": \"false\"}, " \
+			"\"profileRate\" : {\"description\" : \"Count the calls and the time of each " \
+					"function called by the script on one batch of readings every N and log " \
+					"the most expensive functions, 0 disables the profile.\", " \
+				"\"type\": \"integer\", " \
+				"\"displayName\" : \"Profile Sample Rate\", " \
+				"\"minimum\": \"0\", " \
+				"\"order\": \"13\", " \
+				"\"default\": \"0\"}, " \
+			"\"controlSocket\" : {\"description\" : \"Serve runtime diagnostic commands, " \
+					"as statistics, script profiling and batch capture, on a Unix domain " \
+					"socket in the Fledge data directory.\", " \
+				"\"type\": \"boolean\", " \
+				"\"displayName\" : \"Control Socket\", " \
+				"\"order\": \"14\", " \
+				"\"default\": \"false\"} }"
 
 bool pythonInitialised = false;
 
 using namespace std;
 
 /**
- * The Filter plugin interface
+ * Return the current time of the monotonic clock, for the
+ * sampled diagnostics: the ingest stages use Instrumentation
+ *
+ * @return	Nanoseconds
+ */
+static uint64_t monotonicNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * The Filter plugin interface: the only symbols exported
+ * when the plugin is built with hidden visibility
  */
+#pragma GCC visibility push(default)
 extern "C" {
 /**
  * The plugin information structure
@@ -91,6 +193,10 @@ typedef struct
 {
 	Python27Filter	*handle;
 	std::string	configCatName;
+	AssetTrackingQueue
+			*assetTracker;
+	ReadingSetReclaimer
+			*reclaimer;
 } FILTER_INFO;
 
 /**
@@ -127,12 +233,15 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 						outHandle,
 						output);
 	info->configCatName = config->getName();
+	info->assetTracker = new AssetTrackingQueue(info->configCatName);
+	info->reclaimer = ReadingSetReclaimer::acquire();
 	Python27Filter *pyFilter = info->handle;
 
 	// Embedded Python 2.7 program name
 	Py_SetProgramName((char *)config->getName().c_str());
 
 	// Embedded Python 2.7 initialisation
+	uint64_t phaseStart = monotonicNanoseconds();
 	if (!Py_IsInitialized())
 	{
 		Py_Initialize();
@@ -140,6 +249,9 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 		PyThreadState* save = PyEval_SaveThread(); // release GIL
 		pythonInitialised = true;
 	}
+	uint64_t phaseEnd = monotonicNanoseconds();
+	pyFilter->recordStartup(STARTUP_INTERPRETER, phaseStart, phaseEnd);
+	phaseStart = phaseEnd;
 
 	// Pass Fledge Data dir
 	pyFilter->setFiltersPath(getDataDir());
@@ -155,8 +267,13 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 	// Remove temp object
 	Py_CLEAR(pPath);
 
+	// Timing API for the scripts
+	ScriptTimers::initModule();
+
 	// Check first we have a Python script to load
-	if (!pyFilter->setScriptName())
+	bool scriptSet = pyFilter->setScriptName();
+	pyFilter->recordStartup(STARTUP_PATH, phaseStart, monotonicNanoseconds());
+	if (!scriptSet)
 	{
 		// Force disable
 		pyFilter->disableFilter();
@@ -176,6 +293,13 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 		}
 
 		PyGILState_Release(state);
+
+		// Stop asset tracking thread
+		delete info->assetTracker;
+		info->assetTracker = NULL;
+		ReadingSetReclaimer::release();
+		info->reclaimer = NULL;
+
 		// This will abort the filter pipeline set up
 		return NULL;
 	}
@@ -201,6 +325,7 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 {
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python27Filter *filter = info->handle;
+	StatisticsPage& statistics = filter->statistics();
 
 	// Protect against reconfiguration
 	filter->lock();
@@ -220,7 +345,8 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 						      elem != readings.end();
 						      ++elem)
 	{
-		AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName, (*elem)->getAssetName(), string("Filter"));
+		// Queue asset tracking: done by a background thread
+		info->assetTracker->add((*elem)->getAssetName());
 	}
 	
 	/**
@@ -230,10 +356,34 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 	 * 4 - Remove old data and pass new data set onwards
 	 */
 
+	Instrumentation::count(statistics, statistics->batches, 1);
+	unsigned long readingsIn = readings.size();
+	Instrumentation::count(statistics, statistics->readingsIn, readingsIn);
+
+	uint64_t stageStart = Instrumentation::now();
 	PyGILState_STATE state = PyGILState_Ensure();
+	uint64_t stageEnd = Instrumentation::now();
+	filter->recordStage(STAGE_GIL_WAIT, stageStart, stageEnd, readings.size());
+	stageStart = stageEnd;
+
+	// Profile requests of the configuration and control socket
+	if (Instrumentation::sampling)
+	{
+		filter->applyControl();
+	}
+
+	// Hardware counters enabled or disabled by the configuration
+	filter->applyPerfCounters();
+
+	// Keep the schema of recent readings for warm-up
+	filter->captureWarmupSample(readings);
+
+	filter->perfStart();
+
+	Python27Filter::OutputMode outputMode = filter->getOutputMode();
 
 	// - 1 - Create Python list of dicts as input to the filter
-	PyObject* readingsList = filter->createReadingsList(readings);
+	PyObject* readingsList = filter->createReadingsList(readings, Instrumentation::counters);
 
 	// Check for errors
 	if (!readingsList)
@@ -246,23 +396,98 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 					   filter->m_pythonScript.c_str(),
 					  "pass unfiltered data onwards");
 
+		Instrumentation::count(statistics, statistics->errors, 1);
+		Instrumentation::count(statistics, statistics->readingsOut, readings.size());
+
 		// Pass data set to next filter and return
 		filter->m_func(filter->m_data, readingSet);
 		PyGILState_Release(state);
 		return;
 	}
 
+	filter->perfStop(STAGE_CREATE);
+	stageEnd = Instrumentation::now();
+	filter->recordStage(STAGE_CREATE, stageStart, stageEnd, readings.size());
+
+	// Batches captured on request of the control socket,
+	// the input is written before the script can change it
+	bool captured = Instrumentation::sampling && filter->captureSample();
+	string capturedInput;
+	if (captured)
+	{
+		capturedInput = filter->captureJson(readingsList);
+	}
+
+	// Input of the candidate script on sampled batches
+	PyObject* shadowInput = NULL;
+	if (Instrumentation::sampling && filter->shadowSample())
+	{
+		shadowInput = filter->createReadingsList(readings);
+	}
+
+	// Input of the per asset calls on sampled batches
+	PyObject* attributionInput = NULL;
+	if (Instrumentation::sampling && filter->attributionSample())
+	{
+		attributionInput = filter->createReadingsList(readings);
+	}
+
+	// Keep the input dicts: the script can change the list
+	PyObject* inputData = NULL;
+	if (outputMode == Python27Filter::OUTPUT_IN_PLACE)
+	{
+		inputData = PySequence_Tuple(readingsList);
+	}
+
 	// - 2 - Call Python method passing an object
+	stageStart = Instrumentation::now();
+	uint64_t scriptStart = shadowInput ? monotonicNanoseconds() : 0;
+	ScriptProfiler* profiler = Instrumentation::sampling ? filter->profileStart() : NULL;
+	if (Instrumentation::sampling)
+	{
+		ScriptTimers::activate(&filter->scriptTimers());
+	}
+	filter->perfStart();
 	PyObject* pReturn = PyObject_CallFunction(filter->m_pFunc,
 						  (char *)string("O").c_str(),
 						  readingsList);
 
+	filter->perfStop(STAGE_SCRIPT);
+	stageEnd = Instrumentation::now();
+	uint64_t scriptEnd = shadowInput ? monotonicNanoseconds() : 0;
+	if (Instrumentation::sampling)
+	{
+		ScriptTimers::activate(NULL);
+	}
+	if (profiler)
+	{
+		filter->profileStop(profiler);
+	}
+	filter->recordStage(STAGE_SCRIPT, stageStart, stageEnd, readings.size());
+
+	if (captured)
+	{
+		filter->writeCapture(capturedInput, pReturn);
+	}
+
+	// Keep the result to compare with the candidate script
+	long primaryTime = 0;
+	PyObject* shadowPrimary = NULL;
+	if (shadowInput)
+	{
+		primaryTime = (scriptEnd - scriptStart) / 1000;
+		shadowPrimary = pReturn;
+		Py_XINCREF(shadowPrimary);
+	}
+	stageStart = stageEnd;
+
 	// Free filter input data
 	Py_CLEAR(readingsList);
 
 	ReadingSet* finalData = NULL;
 
 	// - 3 - Handle filter returned data
+	filter->perfStart();
 	if (!pReturn)
 	{
 		// Errors while getting result object
@@ -275,10 +500,75 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 
 		// Errors while getting result object
 		filter->logErrorMessage();
+		Instrumentation::count(statistics, statistics->errors, 1);
 
 		// Filter did nothing: just pass input data
 		finalData = (ReadingSet *)readingSet;
 	}
+	else if (outputMode == Python27Filter::OUTPUT_IN_PLACE)
+	{
+		// Update input readings with filtered/modified data
+		if (filter->updateReadings(pReturn,
+					   inputData,
+					   (ReadingSet *)readingSet))
+		{
+			const vector<Reading *>& readings2 = ((ReadingSet *)readingSet)->getAllReadings();
+			for (vector<Reading *>::const_iterator elem = readings2.begin();
+								      elem != readings2.end();
+								      ++elem)
+			{
+				info->assetTracker->add((*elem)->getAssetName());
+			}
+		}
+		else
+		{
+			Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
+						   "invalid filter result, action: %s",
+						   FILTER_NAME,
+						   filter->getConfig().getName().c_str(),
+						   filter->m_pythonScript.c_str(),
+						   "pass unfiltered data onwards");
+			Instrumentation::count(statistics, statistics->errors, 1);
+		}
+
+		// Pass the same ReadingSet onwards
+		finalData = (ReadingSet *)readingSet;
+
+		// Remove pReturn object
+		Py_CLEAR(pReturn);
+	}
+	else if (outputMode == Python27Filter::OUTPUT_APPEND)
+	{
+		// Add new readings from Python filter to input data
+		vector<Reading *> added;
+		if (filter->appendReadings(pReturn,
+					   (ReadingSet *)readingSet,
+					   added))
+		{
+			for (vector<Reading *>::const_iterator elem = added.begin();
+							      elem != added.end();
+							      ++elem)
+			{
+				info->assetTracker->add((*elem)->getAssetName());
+			}
+		}
+		else
+		{
+			Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
+						   "invalid filter result, action: %s",
+						   FILTER_NAME,
+						   filter->getConfig().getName().c_str(),
+						   filter->m_pythonScript.c_str(),
+						   "pass unfiltered data onwards");
+			Instrumentation::count(statistics, statistics->errors, 1);
+		}
+
+		// Pass the same ReadingSet onwards
+		finalData = (ReadingSet *)readingSet;
+
+		// Remove pReturn object
+		Py_CLEAR(pReturn);
+	}
 	else
 	{
 		// Get new set of readings from Python filter
@@ -286,8 +576,9 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 		if (newReadings)
 		{
 			// Filter success
-			// - Delete input data as we have a new set
-			delete (ReadingSet *)readingSet;
+			// - Delete input data as we have a new set:
+			//   destruction is done by the background reclaimer
+			info->reclaimer->reclaim((ReadingSet *)readingSet);
 			readingSet = NULL;
 
 			// - Set new readings with filtered/modified data
@@ -298,7 +589,7 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 								      elem != readings2.end();
 								      ++elem)
 			{
-				AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName, (*elem)->getAssetName(), string("Filter"));
+				info->assetTracker->add((*elem)->getAssetName());
 			}
 
 			// - Remove newReadings pointer
@@ -308,16 +599,64 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 		{
 			// Filtered data error: use current reading set
 			finalData = (ReadingSet *)readingSet;
+			Instrumentation::count(statistics, statistics->errors, 1);
 		}
 
 		// Remove pReturn object
 		Py_CLEAR(pReturn);
 	}
 
+	// Remove input dicts
+	Py_CLEAR(inputData);
+
+	filter->perfStop(STAGE_CONVERT);
+
 	PyGILState_Release(state);
 
+	unsigned long readingsOut = finalData->getCount();
+	filter->recordOutputRatio(readingsIn, readingsOut);
+	stageEnd = Instrumentation::now();
+	filter->recordStage(STAGE_CONVERT, stageStart, stageEnd, readingsOut);
+	stageStart = stageEnd;
+	Instrumentation::count(statistics, statistics->readingsOut, readingsOut);
+	Instrumentation::set(statistics, statistics->assetTrackingDepth, info->assetTracker->depth());
+	Instrumentation::set(statistics, statistics->reclaimerDepth, info->reclaimer->depth());
+
+	// Lag of the output readings, before they are passed on
+	if (Instrumentation::timing)
+	{
+		filter->recordFreshness(finalData->getAllReadings());
+	}
+
 	// - 4 - Pass (new or old) data set to next filter
 	filter->m_func(filter->m_data, finalData);
+
+	filter->recordStage(STAGE_FORWARD, stageStart, Instrumentation::now(), readingsOut);
+
+	// - 5 - Run the candidate script and the per asset calls,
+	// off the critical path
+	if (shadowInput || attributionInput)
+	{
+		state = PyGILState_Ensure();
+		if (shadowInput)
+		{
+			filter->runShadow(shadowInput, shadowPrimary, primaryTime);
+			Py_CLEAR(shadowInput);
+			Py_CLEAR(shadowPrimary);
+		}
+		if (attributionInput)
+		{
+			filter->runAttribution(attributionInput);
+			Py_CLEAR(attributionInput);
+		}
+		PyGILState_Release(state);
+	}
+
+	// Periodic statistics report, the final one is logged at shutdown
+	if (Instrumentation::counters)
+	{
+		filter->reportStatistics();
+	}
 }
 
 /**
@@ -328,12 +667,27 @@ void plugin_shutdown(PLUGIN_HANDLE *handle)
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python27Filter* filter = info->handle;
 
+	// Stop the control socket first: a command may be waiting for the GIL
+	filter->stopControl();
+
 	PyGILState_STATE state = PyGILState_Ensure();
 
 	// Decrement pModule reference count
 	Py_CLEAR(filter->m_pModule);
 	// Decrement pFunc reference count
 	Py_CLEAR(filter->m_pFunc);
+	// Final statistics report
+	filter->logStatistics();
+
+	// Release cached names and keys
+	filter->clearObjectCache();
+	// Release the candidate script
+	filter->clearShadow();
+	// Release the code objects of the function profile
+	filter->clearProfile();
+
+	// Write the pending ingest spans
+	filter->flushTrace();
 
 	// Cleanup Python 2.7
 	if (pythonInitialised)
@@ -341,10 +695,21 @@ void plugin_shutdown(PLUGIN_HANDLE *handle)
 		pythonInitialised = false;
 		Py_Finalize();
 	}
+	else
+	{
+		// The interpreter is kept for the other filter instances
+		PyGILState_Release(state);
+	}
 
 	// Free plugin handle object
 	delete filter;
 
+	// Flush pending asset tracking tuples and stop the thread
+	delete info->assetTracker;
+
+	// Release the shared ReadingSet reclaimer
+	ReadingSetReclaimer::release();
+
 	delete info;
 }
 
@@ -359,6 +724,10 @@ void plugin_reconfigure(PLUGIN_HANDLE *handle, const string& newConfig)
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python27Filter* filter = info->handle;
 
+	// Stop the control socket first: a command may be waiting for the GIL.
+	// It is started again by the new configuration, if enabled.
+	filter->stopControl();
+
 	PyGILState_STATE state = PyGILState_Ensure();
 	filter->reconfigure(newConfig);
 
@@ -367,3 +736,4 @@ void plugin_reconfigure(PLUGIN_HANDLE *handle, const string& newConfig)
 
 // End of extern "C"
 };
+#pragma GCC visibility pop
@@ -13,6 +13,14 @@
 #include <strings.h>
 #include <string>
 #include <iostream>
+#include <sstream>
+#include <sys/time.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <unordered_map>
+#include <algorithm>
 
 #include "python27.h"
 
@@ -20,6 +28,52 @@
 #define PYTHON_SCRIPT_METHOD_PREFIX "_script_"
 #define PYTHON_SCRIPT_FILENAME_EXTENSION ".py"
 #define SCRIPT_CONFIG_ITEM_NAME "script"
+#define OUTPUT_MODE_CONFIG_ITEM_NAME "outputMode"
+#define OUTPUT_MODE_IN_PLACE "Update in place"
+#define OUTPUT_MODE_APPEND "Append"
+
+// Maximum number of cached asset and datapoint name objects
+// and of pooled names returned by the script
+#define NAME_OBJECTS_CACHE_SIZE 4096
+
+// Minimum result size for the parallel conversion
+// and minimum number of readings in each slice
+#define PARALLEL_CONVERSION_MIN_READINGS 2048
+#define PARALLEL_CONVERSION_MIN_SLICE 512
+#define CONVERSION_THREADS_CONFIG_ITEM_NAME "conversionThreads"
+
+// Warm-up of the script after configuration
+#define WARMUP_CONFIG_ITEM_NAME "warmup"
+#define WARMUP_DATA_CONFIG_ITEM_NAME "warmupData"
+#define WARMUP_ITERATIONS 3
+#define WARMUP_BATCH_SIZE 100
+#define WARMUP_SAMPLE_ASSETS 16
+
+// Shadow execution of a candidate script
+#define SHADOW_SCRIPT_CONFIG_ITEM_NAME "shadowScript"
+#define SHADOW_RATE_CONFIG_ITEM_NAME "shadowRate"
+#define SHADOW_PROMOTE_CONFIG_ITEM_NAME "shadowPromote"
+// Candidate script errors logged: the first ones, then one every
+#define SHADOW_ERRORS_LOGGED 10
+#define SHADOW_ERRORS_LOG_INTERVAL 1000
+
+// Per asset cost attribution of the script
+#define ATTRIBUTION_RATE_CONFIG_ITEM_NAME "attributionRate"
+#define ATTRIBUTION_MAX_ASSETS 1024
+#define ATTRIBUTION_TOP_ASSETS 10
+
+// Hardware performance counters of the ingest stages
+#define PERF_COUNTERS_CONFIG_ITEM_NAME "perfCounters"
+#define TRACE_CONFIG_ITEM_NAME "trace"
+#define PROFILE_RATE_CONFIG_ITEM_NAME "profileRate"
+#define CONTROL_SOCKET_CONFIG_ITEM_NAME "controlSocket"
+
+// Data freshness of the output readings
+#define FRESHNESS_MAX_ASSETS 1024
+#define FRESHNESS_TOP_ASSETS 10
+
+// Seconds between two statistics reports in the log
+#define STATISTICS_REPORT_INTERVAL 300
 
 // Filter configuration method
 #define DEFAULT_FILTER_CONFIG_METHOD "set_filter_config"
@@ -52,19 +106,54 @@
 
 using namespace std;
 
+/**
+ * Return the current time of the monotonic clock, for the
+ * startup phases: the ingest stages use Instrumentation
+ *
+ * @return	Nanoseconds
+ */
+static uint64_t monotonicNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 /**
  * Create a Python 2.7 object (list of dicts)
  * to be passed to Python 2.7 loaded filter
  *
  * @param readings	The input readings
+ * @param recordShape	Add the batch to the batch shape statistics
  * @return		PyObject pointer (list of dicts)
  *			or NULL in case of errors
  */
-PyObject* Python27Filter::createReadingsList(const vector<Reading *>& readings)
+PyObject* Python27Filter::createReadingsList(const vector<Reading *>& readings,
+					     bool recordShape)
 {
+	// Removed by the compiler in builds without counters
+	recordShape = Instrumentation::counters && recordShape;
+
+	// Dict keys of each reading: created once
+	if (!m_keyReading)
+	{
+		m_keyReading = PyString_InternFromString("reading");
+		m_keyAssetCode = PyString_InternFromString("asset_code");
+		m_keyId = PyString_InternFromString("id");
+		m_keyTs = PyString_InternFromString("ts");
+		m_keyUserTs = PyString_InternFromString("user_ts");
+	}
+
 	// TODO add checks to all PyList_XYZ methods
 	PyObject* readingsList = PyList_New(0);
 
+	// Asset name object of the previous reading
+	const string* lastAsset = NULL;
+	PyObject* assetVal = NULL;
+
+	// Values of each type in the batch
+	uint64_t values[VALUE_TYPES] = {0, 0, 0, 0};
+
 	// Iterate the input readings
 	for (vector<Reading *>::const_iterator elem = readings.begin();
                                                       elem != readings.end();
@@ -87,60 +176,263 @@ PyObject* Python27Filter::createReadingsList(const vector<Reading *>& readings)
 			if (dataType == DatapointValue::dataTagType::T_INTEGER)
 			{
 				value = PyInt_FromLong((*it)->getData().toInt());
+				values[VALUE_INTEGER]++;
 			}
 			else if (dataType == DatapointValue::dataTagType::T_FLOAT)
 			{
 				value = PyFloat_FromDouble((*it)->getData().toDouble());
+				values[VALUE_FLOAT]++;
 			}
 			else
 			{
 				value = PyString_FromString((*it)->getData().toString().c_str());
+				if (dataType == DatapointValue::dataTagType::T_STRING)
+				{
+					values[VALUE_STRING]++;
+					if (recordShape)
+					{
+						// Without the quotes added by toString()
+						m_batchShape.stringSize.add(PyString_GET_SIZE(value) - 2);
+					}
+				}
+				else
+				{
+					values[VALUE_OTHER]++;
+				}
 			}
 
-			// Add Datapoint: key and value
-			PyDict_SetItemString(newDataPoints,
-					     (*it)->getName().c_str(),
-					     value);
+			// Add Datapoint: key (shared name object) and value
+			PyDict_SetItem(newDataPoints,
+				       this->getNameObject((*it)->getName()),
+				       value);
 			Py_CLEAR(value);
 		}
 
+		if (recordShape)
+		{
+			m_batchShape.datapoints.add(dataPoints.size());
+		}
+
 		// Add reading datapoints
-		PyDict_SetItemString(readingObject, "reading", newDataPoints);
+		PyDict_SetItem(readingObject, m_keyReading, newDataPoints);
 
-		// Add reading asset name
-		PyObject* assetVal = PyString_FromString((*elem)->getAssetName().c_str());
-		PyDict_SetItemString(readingObject, "asset_code", assetVal);
+		// Add reading asset name: shared name object, borrowed reference.
+		// Most batches are runs of the same asset
+		if (!assetVal || (*elem)->getAssetName() != *lastAsset)
+		{
+			lastAsset = &(*elem)->getAssetName();
+			assetVal = this->getNameObject(*lastAsset);
+		}
+		PyDict_SetItem(readingObject, m_keyAssetCode, assetVal);
 
 		/**
 		 * Save id, timestamp and user_timestamp
 		 */
 		// Add reading id
 		PyObject* readingId = PyLong_FromUnsignedLong((*elem)->getId());
-		PyDict_SetItemString(readingObject, "id", readingId);
+		PyDict_SetItem(readingObject, m_keyId, readingId);
 
-		// Add reading timestamp
-		PyObject* readingTs = PyLong_FromUnsignedLong((*elem)->getTimestamp());
-		PyDict_SetItemString(readingObject, "ts", readingTs);
+		// Add reading timestamp: borrowed reference valid for this batch
+		PyObject* readingTs = this->getTimestampObject((*elem)->getTimestamp());
+		PyDict_SetItem(readingObject, m_keyTs, readingTs);
 
-		// Add reading user timestamp
-		PyObject* readingUserTs = PyLong_FromUnsignedLong((*elem)->getUserTimestamp());
-		PyDict_SetItemString(readingObject, "user_ts", readingUserTs);
+		// Add reading user timestamp: borrowed reference valid for this batch
+		PyObject* readingUserTs = this->getTimestampObject((*elem)->getUserTimestamp());
+		PyDict_SetItem(readingObject, m_keyUserTs, readingUserTs);
 
 		// Add new object to the list
 		PyList_Append(readingsList, readingObject);
 
 		Py_CLEAR(newDataPoints);
-		Py_CLEAR(assetVal);
 		Py_CLEAR(readingId);
-		Py_CLEAR(readingTs);
-		Py_CLEAR(readingUserTs);
 		Py_CLEAR(readingObject);
 	}
 
+	// Release the batch timestamp objects
+	this->clearTimestampObjects();
+
+	if (recordShape)
+	{
+		m_batchShape.readings.add(readings.size());
+		for (int type = 0; type < VALUE_TYPES; type++)
+		{
+			m_batchShape.values[type] += values[type];
+		}
+	}
+
 	// Return pointer of new allocated list
 	return readingsList;
 }
 
+/**
+ * Return the shared Python string object for an asset or datapoint name.
+ *
+ * Name objects are interned and cached across batches, so repeated
+ * names do not allocate and scripts can compare them by identity.
+ *
+ * @param name		The asset or datapoint name
+ * @return		Borrowed reference to the string object
+ */
+PyObject* Python27Filter::getNameObject(const string& name)
+{
+	PyObject* nameObject;
+	unordered_map<string, PyObject *>::iterator it = m_nameObjects.find(name);
+	if (it != m_nameObjects.end())
+	{
+		nameObject = it->second;
+	}
+	else
+	{
+		if (m_nameObjects.size() >= NAME_OBJECTS_CACHE_SIZE)
+		{
+			// Too many distinct names: start again
+			this->clearNameObjects();
+		}
+		nameObject = PyString_InternFromString(name.c_str());
+		m_nameObjects[name] = nameObject;
+	}
+
+	return nameObject;
+}
+
+/**
+ * Return a Python long object for a timestamp,
+ * shared by all readings in the batch with the same value.
+ *
+ * @param ts		The timestamp
+ * @return		Borrowed reference valid until
+ *			clearTimestampObjects() is called
+ */
+PyObject* Python27Filter::getTimestampObject(unsigned long ts)
+{
+	unordered_map<unsigned long, PyObject *>::iterator it = m_timestampObjects.find(ts);
+	if (it != m_timestampObjects.end())
+	{
+		return it->second;
+	}
+
+	PyObject* tsObject = PyLong_FromUnsignedLong(ts);
+	m_timestampObjects[ts] = tsObject;
+
+	return tsObject;
+}
+
+/**
+ * Release the timestamp objects of the current batch
+ */
+void Python27Filter::clearTimestampObjects()
+{
+	for (unordered_map<unsigned long, PyObject *>::iterator it = m_timestampObjects.begin();
+								it != m_timestampObjects.end();
+								++it)
+	{
+		Py_DECREF(it->second);
+	}
+	m_timestampObjects.clear();
+}
+
+/**
+ * Release the cached name objects
+ */
+void Python27Filter::clearNameObjects()
+{
+	for (unordered_map<string, PyObject *>::iterator it = m_nameObjects.begin();
+							 it != m_nameObjects.end();
+							 ++it)
+	{
+		Py_DECREF(it->second);
+	}
+	m_nameObjects.clear();
+}
+
+/**
+ * Return the canonical C++ name for an asset or datapoint name
+ * returned by the script.
+ *
+ * The pool is keyed by the Python object: names created by
+ * createReadingsList() are interned, so the lookup of returned
+ * names costs a pointer hash and the string is not decoded again.
+ * The pool keeps a reference to each key so that its address
+ * can not be reused by another object.
+ *
+ * @param name		Python string or unicode object
+ * @return		Pointer to the pooled name, valid until the
+ *			next trimNamePool() call, or NULL if the object
+ *			can not be converted to a string
+ */
+const string* Python27Filter::getPooledName(PyObject* name)
+{
+	if (Instrumentation::counters)
+	{
+		m_namePoolLookups++;
+	}
+
+	unordered_map<PyObject *, string>::iterator it = m_namePool.find(name);
+	if (it != m_namePool.end())
+	{
+		if (Instrumentation::counters)
+		{
+			m_namePoolHits++;
+		}
+		return &it->second;
+	}
+
+	// Unicode objects are converted with the default encoding
+	const char* value = PyString_AsString(name);
+	if (!value)
+	{
+		return NULL;
+	}
+
+	Py_INCREF(name);
+
+	return &m_namePool.insert(make_pair(name, string(value))).first->second;
+}
+
+/**
+ * Empty the name pool if it has grown too big.
+ * Called before the conversion of a new batch only,
+ * as pooled names are referenced during the conversion.
+ */
+void Python27Filter::trimNamePool()
+{
+	if (m_namePool.size() >= NAME_OBJECTS_CACHE_SIZE)
+	{
+		this->clearNamePool();
+	}
+}
+
+/**
+ * Release the name pool
+ */
+void Python27Filter::clearNamePool()
+{
+	for (unordered_map<PyObject *, string>::iterator it = m_namePool.begin();
+							 it != m_namePool.end();
+							 ++it)
+	{
+		Py_DECREF(it->first);
+	}
+	m_namePool.clear();
+}
+
+/**
+ * Release all the Python objects cached by the filter.
+ * Must be called with the GIL held, before Py_Finalize()
+ */
+void Python27Filter::clearObjectCache()
+{
+	this->clearTimestampObjects();
+	this->clearNameObjects();
+	this->clearNamePool();
+	Py_CLEAR(m_keyReading);
+	Py_CLEAR(m_keyAssetCode);
+	Py_CLEAR(m_keyId);
+	Py_CLEAR(m_keyTs);
+	Py_CLEAR(m_keyUserTs);
+	m_scriptTimers.clear();
+}
+
 /**
  * Get the vector of filtered readings from Python 2.7 script
  *
@@ -153,6 +445,17 @@ PyObject* Python27Filter::createReadingsList(const vector<Reading *>& readings)
  */
 vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 {
+	// Names returned by the previous batches
+	this->trimNamePool();
+
+	// Large results are converted by the thread pool
+	if (m_conversionPool &&
+	    PyList_Check(filteredData) &&
+	    PyList_GET_SIZE(filteredData) >= PARALLEL_CONVERSION_MIN_READINGS)
+	{
+		return this->getFilteredReadingsParallel(filteredData);
+	}
+
 	// Create result set
 	vector<Reading *>* newReadings = new vector<Reading *>();
 
@@ -195,6 +498,19 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 			return NULL;
 		}
 
+		// Canonical asset name from the name pool
+		const string* assetName = this->getPooledName(assetCode);
+		if (!assetName)
+		{
+			if (PyErr_Occurred())
+			{
+				this->logErrorMessage();
+			}
+			delete newReadings;
+
+			return NULL;
+		}
+
 		// Fetch all Datapoins in 'reading' dict			
 		PyObject *dKey, *dValue;
 		Py_ssize_t dPos = 0;
@@ -204,7 +520,20 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 		// dKey and dValue are borrowed references
 		while (PyDict_Next(reading, &dPos, &dKey, &dValue))
 		{
-			DatapointValue* dataPoint;
+			// Canonical datapoint name from the name pool
+			const string* dpName = this->getPooledName(dKey);
+			if (!dpName)
+			{
+				if (PyErr_Occurred())
+				{
+					this->logErrorMessage();
+				}
+				delete newReadings;
+
+				return NULL;
+			}
+
+			DatapointValue* dataPoint = NULL;
 			if (PyInt_Check(dValue) || PyLong_Check(dValue))
 			{
 				dataPoint = new DatapointValue((long)PyInt_AsUnsignedLongMask(dValue));
@@ -219,8 +548,14 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 			}
 			else
 			{
+				Logger::getLogger()->error("Filter '%s' (%s), datapoint '%s' of reading %d "
+							   "has an unsupported type '%s'",
+							   this->getName().c_str(),
+							   this->getConfig().getName().c_str(),
+							   dpName->c_str(),
+							   i,
+							   Py_TYPE(dValue)->tp_name);
 				delete newReadings;
-				delete dataPoint;
 
 				return NULL;
 			}
@@ -228,13 +563,13 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 			// Add / Update the new Reading data			
 			if (newReading == NULL)
 			{
-				newReading = new Reading(PyString_AsString(assetCode),
-							 new Datapoint(PyString_AsString(dKey),
+				newReading = new Reading(*assetName,
+							 new Datapoint(*dpName,
 								       *dataPoint));
 			}
 			else
 			{
-				newReading->addDatapoint(new Datapoint(PyString_AsString(dKey),
+				newReading->addDatapoint(new Datapoint(*dpName,
 								       *dataPoint));
 			}
 
@@ -269,7 +604,8 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 			delete dataPoint;
 		}
 
-		if (newReadings)
+		// A reading with no datapoints is dropped
+		if (newReading)
 		{
 			// Add the new reading to result vector
 			newReadings->push_back(newReading);
@@ -280,194 +616,1884 @@ vector<Reading *>* Python27Filter::getFilteredReadings(PyObject* filteredData)
 }
 
 /**
- * Log current Python 2.7 error message
- *
+ * Datapoint extracted from the script result
+ * for the parallel conversion
  */
-void Python27Filter::logErrorMessage()
+typedef struct
 {
-	//Get error message
-	PyObject *pType, *pValue, *pTraceback;
-	PyErr_Fetch(&pType, &pValue, &pTraceback);
-
-	// NOTE from :
-	// https://docs.python.org/2/c-api/exceptions.html
-	//
-	// The value and traceback object may be NULL
-	// even when the type object is not.	
-	const char* pErrorMessage = pValue ?
-				    PyString_AsString(pValue) :
-				    "no error description.";
-
-	Logger::getLogger()->fatal("Filter '%s', script "
-				   "'%s': Error '%s'",
-				   this->getName().c_str(),
-				   m_pythonScript.c_str(),
-				   pErrorMessage ?
-				   pErrorMessage :
-				   "no description");
+	const string*			name;
+	DatapointValue::dataTagType	type;
+	long				intValue;
+	double				floatValue;
+	std::string			stringValue;
+} ExtractedDatapoint;
 
-	// Reset error
-	PyErr_Clear();
-
-	// Remove references
-	Py_CLEAR(pType);
-	Py_CLEAR(pValue);
-	Py_CLEAR(pTraceback);
-}
-
-bool Python27Filter::configure()
+/**
+ * Reading extracted from the script result
+ * for the parallel conversion
+ */
+typedef struct
 {
-	// Import script as module
-	// NOTE:
-	// Script file name is:
-	// lowercase(categoryName) + _script_ + methodName + ".py"
+	const string*	assetName;
+	size_t		firstDatapoint;
+	size_t		datapoints;
+	bool		hasId;
+	bool		hasTs;
+	bool		hasUserTs;
+	unsigned long	id;
+	unsigned long	ts;
+	unsigned long	userTs;
+} ExtractedReading;
 
-	// 1) Get methodName
-	std::size_t found = m_pythonScript.rfind(PYTHON_SCRIPT_METHOD_PREFIX);
-	string filterMethod = m_pythonScript.substr(found + strlen(PYTHON_SCRIPT_METHOD_PREFIX));
-	// Remove .py from filterMethod
-	found = filterMethod.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
-	filterMethod.replace(found,
-			     strlen(PYTHON_SCRIPT_FILENAME_EXTENSION),
-			     "");
-	// Remove .py from pythonScript
-	found = m_pythonScript.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
-	m_pythonScript.replace(found,
-			     strlen(PYTHON_SCRIPT_FILENAME_EXTENSION),
-			     "");
+/**
+ * Get the vector of filtered readings from Python 2.7 script
+ * using the conversion thread pool.
+ *
+ * A first pass, with the GIL held, copies the datapoint values,
+ * strings included, and the timestamps in a flat intermediate:
+ * names are taken from the name pool, which only the ingest
+ * thread changes. The pool threads then build Reading and
+ * Datapoint objects from slices of it, without the Python API:
+ * the GIL is released meanwhile for the other filter instances.
+ *
+ * Readings with no datapoints are dropped, as by the serial
+ * conversion.
+ *
+ * @param filteredData	Python 2.7 Object (list of dicts)
+ * @return		Pointer to a new allocated vector<Reading *>
+ *			or NULL in case of errors
+ */
+vector<Reading *>* Python27Filter::getFilteredReadingsParallel(PyObject* filteredData)
+{
+	Py_ssize_t nReadings = PyList_GET_SIZE(filteredData);
 
-	// 2) Import Python script
-	PyObject* pName = PyString_FromString(m_pythonScript.c_str());
-	m_pModule = PyImport_Import(pName);
-	// Delete pName reference
-	Py_CLEAR(pName);
+	vector<ExtractedReading> readings(nReadings);
+	vector<ExtractedDatapoint> dataPoints;
+	dataPoints.reserve(nReadings * 4);
 
-	// Check whether the Python module has been imported
-	if (!m_pModule)
+	// - 1 - Extraction pass, GIL held
+	for (Py_ssize_t i = 0; i < nReadings; i++)
 	{
-		// Failure
-		if (PyErr_Occurred())
+		// Borrowed references
+		PyObject* element = PyList_GET_ITEM(filteredData, i);
+		PyObject* assetCode = PyDict_Check(element) ?
+					PyDict_GetItemString(element, "asset_code") :
+					NULL;
+		PyObject* reading = PyDict_Check(element) ?
+					PyDict_GetItemString(element, "reading") :
+					NULL;
+		if (!assetCode ||
+		    !reading ||
+		    !PyDict_Check(reading))
 		{
-			this->logErrorMessage();
+			if (PyErr_Occurred())
+			{
+				this->logErrorMessage();
+			}
+			Logger::getLogger()->error("Filter '%s' (%s), element %ld of the script "
+						   "result is not a reading dict",
+						   this->getName().c_str(),
+						   this->getConfig().getName().c_str(),
+						   (long)i);
+			return NULL;
 		}
-		Logger::getLogger()->fatal("Filter '%s' (%s), cannot import Python 2.7 script "
-					   "'%s' from '%s'",
-					   this->getName().c_str(),
-					   this->getConfig().getName().c_str(),
-					   m_pythonScript.c_str(),
-					   this->getFiltersPath().c_str());
 
-		// This will abort the filter pipeline set up
-		return false;
+		ExtractedReading& extracted = readings[i];
+		extracted.assetName = this->getPooledName(assetCode);
+		if (!extracted.assetName)
+		{
+			if (PyErr_Occurred())
+			{
+				this->logErrorMessage();
+			}
+			return NULL;
+		}
+		extracted.firstDatapoint = dataPoints.size();
+
+		PyObject *dKey, *dValue;
+		Py_ssize_t dPos = 0;
+		while (PyDict_Next(reading, &dPos, &dKey, &dValue))
+		{
+			ExtractedDatapoint dp;
+			dp.name = this->getPooledName(dKey);
+			if (!dp.name)
+			{
+				if (PyErr_Occurred())
+				{
+					this->logErrorMessage();
+				}
+				return NULL;
+			}
+			if (PyInt_Check(dValue) || PyLong_Check(dValue))
+			{
+				dp.type = DatapointValue::dataTagType::T_INTEGER;
+				dp.intValue = (long)PyInt_AsUnsignedLongMask(dValue);
+			}
+			else if (PyFloat_Check(dValue))
+			{
+				dp.type = DatapointValue::dataTagType::T_FLOAT;
+				dp.floatValue = PyFloat_AS_DOUBLE(dValue);
+			}
+			else if (PyString_Check(dValue))
+			{
+				dp.type = DatapointValue::dataTagType::T_STRING;
+				dp.stringValue.assign(PyString_AS_STRING(dValue),
+						      PyString_GET_SIZE(dValue));
+			}
+			else
+			{
+				Logger::getLogger()->error("Filter '%s' (%s), datapoint '%s' of reading %ld "
+							   "has an unsupported type '%s'",
+							   this->getName().c_str(),
+							   this->getConfig().getName().c_str(),
+							   dp.name->c_str(),
+							   (long)i,
+							   Py_TYPE(dValue)->tp_name);
+				return NULL;
+			}
+			dataPoints.push_back(std::move(dp));
+		}
+		extracted.datapoints = dataPoints.size() - extracted.firstDatapoint;
+
+		// Borrowed references
+		PyObject* id = PyDict_GetItemString(element, "id");
+		extracted.hasId = id && PyLong_Check(id);
+		extracted.id = extracted.hasId ? PyLong_AsUnsignedLong(id) : 0;
+		PyObject* ts = PyDict_GetItemString(element, "ts");
+		extracted.hasTs = ts && PyLong_Check(ts);
+		extracted.ts = extracted.hasTs ? PyLong_AsUnsignedLong(ts) : 0;
+		PyObject* uts = PyDict_GetItemString(element, "user_ts");
+		extracted.hasUserTs = uts && PyLong_Check(uts);
+		extracted.userTs = extracted.hasUserTs ? PyLong_AsUnsignedLong(uts) : 0;
 	}
 
-	// NOTE:
-	// Filter method to call is the same as filter name
-	// Fetch filter method in loaded object
-	m_pFunc = PyObject_GetAttrString(m_pModule, filterMethod.c_str());
+	// - 2 - Build readings in parallel slices
+	vector<Reading *> built(nReadings, NULL);
+	unsigned int maxSlices = 4 * (m_conversionPool->size() + 1);
+	unsigned int slices = nReadings / PARALLEL_CONVERSION_MIN_SLICE;
+	if (slices > maxSlices)
+	{
+		slices = maxSlices;
+	}
+	if (slices == 0)
+	{
+		slices = 1;
+	}
+	size_t sliceSize = (nReadings + slices - 1) / slices;
 
-	if (!PyCallable_Check(m_pFunc))
+	function<void(unsigned int)> work = [&](unsigned int slice)
 	{
-		// Failure
-		if (PyErr_Occurred())
+		size_t end = min((size_t)nReadings, (slice + 1) * sliceSize);
+		for (size_t i = slice * sliceSize; i < end; i++)
 		{
-			this->logErrorMessage();
-		}
+			const ExtractedReading& extracted = readings[i];
+			if (extracted.datapoints == 0)
+			{
+				continue;
+			}
 
-		Logger::getLogger()->fatal("Filter %s (%s) error: cannot find Python 2.7 method "
-					   "'%s' in loaded module '%s.py'",
-					   this->getName().c_str(),
-					   this->getConfig().getName().c_str(),
-					   filterMethod.c_str(),
-					   m_pythonScript.c_str());
-		Py_CLEAR(m_pModule);
+			vector<Datapoint *> values;
+			values.reserve(extracted.datapoints);
+			for (size_t j = extracted.firstDatapoint;
+			     j < extracted.firstDatapoint + extracted.datapoints;
+			     j++)
+			{
+				const ExtractedDatapoint& dp = dataPoints[j];
+				if (dp.type == DatapointValue::dataTagType::T_INTEGER)
+				{
+					DatapointValue value(dp.intValue);
+					values.push_back(new Datapoint(*dp.name, value));
+				}
+				else if (dp.type == DatapointValue::dataTagType::T_FLOAT)
+				{
+					DatapointValue value(dp.floatValue);
+					values.push_back(new Datapoint(*dp.name, value));
+				}
+				else
+				{
+					DatapointValue value(dp.stringValue);
+					values.push_back(new Datapoint(*dp.name, value));
+				}
+			}
+
+			Reading* newReading = new Reading(*extracted.assetName, values);
+			if (extracted.hasId)
+			{
+				newReading->setId(extracted.id);
+			}
+			if (extracted.hasTs)
+			{
+				newReading->setTimestamp(extracted.ts);
+			}
+			if (extracted.hasUserTs)
+			{
+				newReading->setUserTimestamp(extracted.userTs);
+			}
+			built[i] = newReading;
+		}
+	};
+
+	// The pool is not replaced by a reconfiguration while it runs:
+	// the lock is taken with the GIL held and released before
+	// the GIL is taken back, which the reconfiguration holds
+	bool success;
+	unique_lock<mutex> poolLock(m_conversionMutex);
+	Py_BEGIN_ALLOW_THREADS
+	success = m_conversionPool->run(slices, work);
+	poolLock.unlock();
+	Py_END_ALLOW_THREADS
+
+	// - 3 - Stitch the slices together, in order
+	vector<Reading *>* newReadings = new vector<Reading *>();
+	newReadings->reserve(nReadings);
+	for (vector<Reading *>::iterator it = built.begin(); it != built.end(); ++it)
+	{
+		if (*it)
+		{
+			if (success)
+			{
+				newReadings->push_back(*it);
+			}
+			else
+			{
+				delete *it;
+			}
+		}
+	}
+
+	if (!success)
+	{
+		delete newReadings;
+		return NULL;
+	}
+
+	return newReadings;
+}
+
+/**
+ * Check the script result can be converted to readings
+ * before any change is made to the input data
+ *
+ * @param filteredData	Python 2.7 Object (list of dicts)
+ * @return		True if all elements are valid readings
+ */
+bool Python27Filter::checkFilteredReadings(PyObject* filteredData)
+{
+	// Names returned by the previous batches
+	this->trimNamePool();
+
+	if (!PyList_Check(filteredData))
+	{
+		return false;
+	}
+
+	for (Py_ssize_t i = 0; i < PyList_GET_SIZE(filteredData); i++)
+	{
+		// Borrowed reference
+		PyObject* element = PyList_GET_ITEM(filteredData, i);
+		if (!PyDict_Check(element))
+		{
+			return false;
+		}
+
+		// Borrowed references
+		PyObject* assetCode = PyDict_GetItemString(element, "asset_code");
+		PyObject* reading = PyDict_GetItemString(element, "reading");
+		// Asset and datapoint names are added to the name pool
+		if (!assetCode ||
+		    !this->getPooledName(assetCode) ||
+		    !reading ||
+		    !PyDict_Check(reading))
+		{
+			return false;
+		}
+
+		PyObject *dKey, *dValue;
+		Py_ssize_t dPos = 0;
+		while (PyDict_Next(reading, &dPos, &dKey, &dValue))
+		{
+			if (!this->getPooledName(dKey) ||
+			    !(PyInt_Check(dValue) ||
+			      PyLong_Check(dValue) ||
+			      PyFloat_Check(dValue) ||
+			      PyString_Check(dValue)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Create a DatapointValue from a Python 2.7 object
+ *
+ * @param value		The Python object: int, long, float or string
+ * @return		New allocated DatapointValue
+ */
+static DatapointValue* createDatapointValue(PyObject* value)
+{
+	if (PyInt_Check(value) || PyLong_Check(value))
+	{
+		return new DatapointValue((long)PyInt_AsUnsignedLongMask(value));
+	}
+	else if (PyFloat_Check(value))
+	{
+		return new DatapointValue(PyFloat_AS_DOUBLE(value));
+	}
+	else
+	{
+		return new DatapointValue(string(PyString_AS_STRING(value)));
+	}
+}
+
+/**
+ * Update a DatapointValue with a Python 2.7 object,
+ * the value is replaced only if it has been changed.
+ *
+ * Non numeric values are passed to the script in their
+ * string representation: an unchanged string leaves
+ * the original value and type untouched.
+ *
+ * @param data		The DatapointValue to update
+ * @param value		The Python object: int, long, float or string
+ */
+static void updateDatapointValue(DatapointValue& data, PyObject* value)
+{
+	DatapointValue::dataTagType dataType = data.getType();
+
+	if (PyInt_Check(value) || PyLong_Check(value))
+	{
+		long newValue = (long)PyInt_AsUnsignedLongMask(value);
+		if (dataType != DatapointValue::dataTagType::T_INTEGER ||
+		    data.toInt() != newValue)
+		{
+			data = DatapointValue(newValue);
+		}
+	}
+	else if (PyFloat_Check(value))
+	{
+		double newValue = PyFloat_AS_DOUBLE(value);
+		if (dataType != DatapointValue::dataTagType::T_FLOAT ||
+		    data.toDouble() != newValue)
+		{
+			data = DatapointValue(newValue);
+		}
+	}
+	else
+	{
+		if (dataType == DatapointValue::dataTagType::T_INTEGER ||
+		    dataType == DatapointValue::dataTagType::T_FLOAT ||
+		    data.toString().compare(PyString_AS_STRING(value)) != 0)
+		{
+			data = DatapointValue(string(PyString_AS_STRING(value)));
+		}
+	}
+}
+
+/**
+ * Set id, ts and user_ts of a reading from a script result element,
+ * values are set only if they differ from the current ones
+ *
+ * @param reading	The reading to update
+ * @param element	The Python dict of the reading
+ */
+static void updateReadingTimestamps(Reading* reading, PyObject* element)
+{
+	// Borrowed references
+	PyObject* id = PyDict_GetItemString(element, "id");
+	if (id && PyLong_Check(id))
+	{
+		unsigned long value = PyLong_AsUnsignedLong(id);
+		if (value != reading->getId())
+		{
+			reading->setId(value);
+		}
+	}
+	PyObject* ts = PyDict_GetItemString(element, "ts");
+	if (ts && PyLong_Check(ts))
+	{
+		unsigned long value = PyLong_AsUnsignedLong(ts);
+		if (value != reading->getTimestamp())
+		{
+			reading->setTimestamp(value);
+		}
+	}
+	PyObject* uts = PyDict_GetItemString(element, "user_ts");
+	if (uts && PyLong_Check(uts))
+	{
+		unsigned long value = PyLong_AsUnsignedLong(uts);
+		if (value != reading->getUserTimestamp())
+		{
+			reading->setUserTimestamp(value);
+		}
+	}
+}
+
+/**
+ * Create a new Reading from a script result element
+ * which does not come from the input data
+ *
+ * @param element	The Python dict of the reading, already checked
+ * @return		New allocated Reading or NULL if
+ *			there are no datapoints
+ */
+Reading* Python27Filter::createReading(PyObject* element)
+{
+	// Borrowed references
+	PyObject* assetCode = PyDict_GetItemString(element, "asset_code");
+	PyObject* reading = PyDict_GetItemString(element, "reading");
+
+	vector<Datapoint *> values;
+	PyObject *dKey, *dValue;
+	Py_ssize_t dPos = 0;
+	while (PyDict_Next(reading, &dPos, &dKey, &dValue))
+	{
+		DatapointValue* dataPoint = createDatapointValue(dValue);
+		values.push_back(new Datapoint(*this->getPooledName(dKey), *dataPoint));
+		delete dataPoint;
+	}
+
+	if (values.empty())
+	{
+		return NULL;
+	}
+
+	Reading* newReading = new Reading(*this->getPooledName(assetCode), values);
+	updateReadingTimestamps(newReading, element);
+
+	return newReading;
+}
+
+/**
+ * Update an input Reading with the content of its script result element:
+ * changed values are updated, removed datapoints are deleted and
+ * new datapoints are appended.
+ *
+ * @param reading	The input reading
+ * @param element	The Python dict of the reading, already checked
+ * @return		False if the reading has no datapoints left
+ */
+bool Python27Filter::updateReading(Reading* reading, PyObject* element)
+{
+	// Borrowed references
+	PyObject* assetCode = PyDict_GetItemString(element, "asset_code");
+	PyObject* readingDict = PyDict_GetItemString(element, "reading");
+
+	const string* assetName = this->getPooledName(assetCode);
+	if (reading->getAssetName() != *assetName)
+	{
+		reading->setAssetName(*assetName);
+	}
+
+	// Update or remove existing datapoints
+	vector<Datapoint *>& dataPoints = reading->getReadingData();
+	size_t kept = 0;
+	for (size_t i = 0; i < dataPoints.size(); i++)
+	{
+		Datapoint* dp = dataPoints[i];
+		// Borrowed reference
+		PyObject* value = PyDict_GetItem(readingDict, this->getNameObject(dp->getName()));
+		if (!value)
+		{
+			// Datapoint removed by the script
+			delete dp;
+			continue;
+		}
+		updateDatapointValue(dp->getData(), value);
+		dataPoints[kept++] = dp;
+	}
+	dataPoints.resize(kept);
+
+	// Append datapoints added by the script
+	if ((size_t)PyDict_Size(readingDict) > kept)
+	{
+		PyObject *dKey, *dValue;
+		Py_ssize_t dPos = 0;
+		while (PyDict_Next(readingDict, &dPos, &dKey, &dValue))
+		{
+			const string* name = this->getPooledName(dKey);
+			bool found = false;
+			for (size_t i = 0; i < kept && !found; i++)
+			{
+				found = dataPoints[i]->getName() == *name;
+			}
+			if (!found)
+			{
+				DatapointValue* dataPoint = createDatapointValue(dValue);
+				reading->addDatapoint(new Datapoint(*name, *dataPoint));
+				delete dataPoint;
+			}
+		}
+	}
+
+	updateReadingTimestamps(reading, element);
+
+	return !dataPoints.empty();
+}
+
+/**
+ * Write the script results back into the input ReadingSet.
+ *
+ * Elements of the result list which are dicts passed to the script
+ * update the Reading they have been created from, other elements
+ * become new Readings and input Readings whose dict has not been
+ * returned are deleted. Order follows the script result list.
+ *
+ * @param filteredData	Python 2.7 Object (list of dicts)
+ * @param inputData	Tuple of the dicts passed to the script,
+ *			in the order of the input readings
+ * @param readingSet	The input ReadingSet to update
+ * @return		True on success, false if the script result
+ *			is not valid: the input ReadingSet is unchanged
+ */
+bool Python27Filter::updateReadings(PyObject* filteredData,
+				    PyObject* inputData,
+				    ReadingSet* readingSet)
+{
+	if (!inputData ||
+	    !PyTuple_Check(inputData) ||
+	    !this->checkFilteredReadings(filteredData))
+	{
+		if (PyErr_Occurred())
+		{
+			this->logErrorMessage();
+		}
+		return false;
+	}
+
+	vector<Reading *>* readings = readingSet->getAllReadingsPtr();
+	Py_ssize_t nInput = PyTuple_GET_SIZE(inputData);
+	if ((size_t)nInput != readings->size())
+	{
+		return false;
+	}
+
+	// Input readings reused in the output and
+	// input readings left with no datapoints
+	vector<bool> used(readings->size(), false);
+	vector<bool> emptied(readings->size(), false);
+	// Input dict to input reading index, built only if
+	// the script changes the order of the input dicts
+	unordered_map<PyObject *, Py_ssize_t> inputIndex;
+	Py_ssize_t next = 0;
+
+	vector<Reading *> output;
+	output.reserve(PyList_GET_SIZE(filteredData));
+
+	for (Py_ssize_t i = 0; i < PyList_GET_SIZE(filteredData); i++)
+	{
+		// Borrowed reference
+		PyObject* element = PyList_GET_ITEM(filteredData, i);
+
+		// Find the input reading of this element
+		Py_ssize_t index = -1;
+		if (next < nInput && PyTuple_GET_ITEM(inputData, next) == element)
+		{
+			index = next;
+		}
+		else
+		{
+			if (inputIndex.empty())
+			{
+				inputIndex.reserve(nInput);
+				for (Py_ssize_t j = 0; j < nInput; j++)
+				{
+					inputIndex[PyTuple_GET_ITEM(inputData, j)] = j;
+				}
+			}
+			auto it = inputIndex.find(element);
+			if (it != inputIndex.end())
+			{
+				index = it->second;
+			}
+		}
+
+		Reading* reading;
+		if (index < 0)
+		{
+			// New reading from the script
+			reading = this->createReading(element);
+		}
+		else
+		{
+			next = index + 1;
+			reading = (*readings)[index];
+			if (used[index])
+			{
+				// Same dict returned twice: use a copy
+				reading = new Reading(*reading);
+			}
+			used[index] = true;
+
+			if (!this->updateReading(reading, element))
+			{
+				// No datapoints left
+				if (reading != (*readings)[index])
+				{
+					delete reading;
+				}
+				else
+				{
+					emptied[index] = true;
+				}
+				reading = NULL;
+			}
+		}
+
+		if (reading)
+		{
+			output.push_back(reading);
+		}
+	}
+
+	// Delete input readings dropped by the script
+	for (size_t i = 0; i < readings->size(); i++)
+	{
+		if (!used[i] || emptied[i])
+		{
+			delete (*readings)[i];
+		}
+	}
+
+	// Move the result into the input ReadingSet: the readings
+	// are either in the output or already deleted
+	readingSet->removeAll();
+	readingSet->append(output);
+
+	return true;
+}
+
+/**
+ * Append the readings returned by the script to the input ReadingSet.
+ *
+ * In this mode the script returns only the readings it creates,
+ * the input readings are passed onwards as they are.
+ *
+ * @param filteredData	Python 2.7 Object (list of dicts)
+ * @param readingSet	The input ReadingSet
+ * @param added		The readings appended to the ReadingSet
+ * @return		True on success, false if the script result
+ *			is not valid: the input ReadingSet is unchanged
+ */
+bool Python27Filter::appendReadings(PyObject* filteredData,
+				    ReadingSet* readingSet,
+				    vector<Reading *>& added)
+{
+	if (!this->checkFilteredReadings(filteredData))
+	{
+		if (PyErr_Occurred())
+		{
+			this->logErrorMessage();
+		}
+		return false;
+	}
+
+	added.reserve(PyList_GET_SIZE(filteredData));
+	for (Py_ssize_t i = 0; i < PyList_GET_SIZE(filteredData); i++)
+	{
+		// Borrowed reference
+		Reading* reading = this->createReading(PyList_GET_ITEM(filteredData, i));
+		if (reading)
+		{
+			added.push_back(reading);
+		}
+	}
+
+	if (!added.empty())
+	{
+		readingSet->append(added);
+	}
+
+	return true;
+}
+
+/**
+ * Write the ingest spans of the process trace buffer to a file
+ * and stop tracing: called before the filter is deleted, as the
+ * buffered spans refer to the filter name
+ */
+void Python27Filter::flushTrace()
+{
+	if (m_trace)
+	{
+		m_trace = false;
+		TraceBuffer::getInstance()->flush();
+	}
+}
+
+/**
+ * Log the filter statistics if the report interval has elapsed
+ */
+void Python27Filter::reportStatistics()
+{
+	time_t now = time(NULL);
+	if (now - m_lastStatistics >= STATISTICS_REPORT_INTERVAL)
+	{
+		m_lastStatistics = now;
+		this->logStatistics();
+	}
+}
+
+/**
+ * Log the filter statistics
+ */
+void Python27Filter::logStatistics()
+{
+	if (Instrumentation::counters)
+	{
+		const StatisticsLayout* counters = m_statistics.get();
+		uint64_t batches = counters->batches.load(memory_order_relaxed);
+		Logger::getLogger()->info("Filter '%s' (%s) statistics: "
+					  "%lu batches, %lu readings in, %lu readings out, %lu errors, "
+					  "average time in us: GIL wait %.1f, create %.1f, script %.1f, "
+					  "convert %.1f, forward %.1f",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  (unsigned long)batches,
+					  (unsigned long)counters->readingsIn.load(memory_order_relaxed),
+					  (unsigned long)counters->readingsOut.load(memory_order_relaxed),
+					  (unsigned long)counters->errors.load(memory_order_relaxed),
+					  batches ? counters->stageTime[STAGE_GIL_WAIT] / 1e3 / batches : 0.0,
+					  batches ? counters->stageTime[STAGE_CREATE] / 1e3 / batches : 0.0,
+					  batches ? counters->stageTime[STAGE_SCRIPT] / 1e3 / batches : 0.0,
+					  batches ? counters->stageTime[STAGE_CONVERT] / 1e3 / batches : 0.0,
+					  batches ? counters->stageTime[STAGE_FORWARD] / 1e3 / batches : 0.0);
+	}
+
+	static const char* stageNames[STAGE_COUNT] = {
+		"GIL wait", "create", "script", "convert", "forward"
+	};
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		if (!m_stageLatency[stage].count())
+		{
+			continue;
+		}
+		string perf;
+		if (m_perfCounters)
+		{
+			perf = m_perfCounters->report((IngestStage)stage);
+		}
+		Logger::getLogger()->info("Filter '%s' (%s) %s latency us: %s%s%s",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  stageNames[stage],
+					  m_stageLatency[stage].toString().c_str(),
+					  perf.empty() ? "" : ", ",
+					  perf.c_str());
+	}
+	if (Instrumentation::counters)
+	{
+		Logger::getLogger()->info("Filter '%s' (%s) statistics: "
+					  "name pool %lu names, %lu lookups, hit rate %.1f%%",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  (unsigned long)m_namePool.size(),
+					  m_namePoolLookups,
+					  m_namePoolLookups ?
+					  (100.0 * m_namePoolHits) / m_namePoolLookups :
+					  0.0);
+	}
+
+	this->logBatchShape();
+
+	this->logFreshness();
+	this->logAssetCosts();
+
+	const unordered_map<PyObject*, ScriptTimers::Timer>& timers = m_scriptTimers.timers();
+	for (unordered_map<PyObject*, ScriptTimers::Timer>::const_iterator it = timers.begin();
+									   it != timers.end();
+									   ++it)
+	{
+		Logger::getLogger()->info("Filter '%s' (%s) script timer '%s' ns: %s",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  it->second.name.c_str(),
+					  it->second.histogram.toString().c_str());
+	}
+
+	this->logProfile();
+
+	if (m_shadowStats.batches)
+	{
+		Logger::getLogger()->info("Filter '%s' (%s) candidate script '%s': "
+					  "%lu batches, average time %.1f us (primary %.1f us), "
+					  "%lu errors (primary %lu), "
+					  "%lu batches with %lu different readings",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_shadowScript.c_str(),
+					  m_shadowStats.batches,
+					  (double)m_shadowStats.candidateTime / m_shadowStats.batches,
+					  (double)m_shadowStats.primaryTime / m_shadowStats.batches,
+					  m_shadowStats.candidateErrors,
+					  m_shadowStats.primaryErrors,
+					  m_shadowStats.differentBatches,
+					  m_shadowStats.differentReadings);
+	}
+}
+
+/**
+ * Log the function profile of the script, if any batch
+ * has been profiled
+ */
+void Python27Filter::logProfile()
+{
+	if (!m_profiler || !m_profiler->batches())
+	{
+		return;
+	}
+	Logger::getLogger()->info("Filter '%s' (%s) script profile of %lu batches:",
+				  this->getName().c_str(),
+				  this->getConfig().getName().c_str(),
+				  m_profiler->batches());
+	stringstream report(m_profiler->report(PROFILE_REPORT_FUNCTIONS));
+	string line;
+	while (getline(report, line))
+	{
+		Logger::getLogger()->info("%s", line.c_str());
+	}
+}
+
+/**
+ * Log current Python 2.7 error message
+ *
+ */
+void Python27Filter::logErrorMessage()
+{
+	//Get error message
+	PyObject *pType, *pValue, *pTraceback;
+	PyErr_Fetch(&pType, &pValue, &pTraceback);
+
+	// NOTE from :
+	// https://docs.python.org/2/c-api/exceptions.html
+	//
+	// The value and traceback object may be NULL
+	// even when the type object is not.	
+	const char* pErrorMessage = pValue ?
+				    PyString_AsString(pValue) :
+				    "no error description.";
+
+	Logger::getLogger()->fatal("Filter '%s', script "
+				   "'%s': Error '%s'",
+				   this->getName().c_str(),
+				   m_pythonScript.c_str(),
+				   pErrorMessage ?
+				   pErrorMessage :
+				   "no description");
+
+	// Reset error
+	PyErr_Clear();
+
+	// Remove references
+	Py_CLEAR(pType);
+	Py_CLEAR(pValue);
+	Py_CLEAR(pTraceback);
+}
+
+bool Python27Filter::configure()
+{
+	// Import script as module
+	// NOTE:
+	// Script file name is:
+	// lowercase(categoryName) + _script_ + methodName + ".py"
+
+	// 1) Get methodName
+	std::size_t found = m_pythonScript.rfind(PYTHON_SCRIPT_METHOD_PREFIX);
+	string filterMethod = m_pythonScript.substr(found + strlen(PYTHON_SCRIPT_METHOD_PREFIX));
+	// Remove .py from filterMethod
+	found = filterMethod.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
+	filterMethod.replace(found,
+			     strlen(PYTHON_SCRIPT_FILENAME_EXTENSION),
+			     "");
+	// Remove .py from pythonScript
+	found = m_pythonScript.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
+	m_pythonScript.replace(found,
+			     strlen(PYTHON_SCRIPT_FILENAME_EXTENSION),
+			     "");
+
+	// A promoted candidate script replaces the configured one
+	string shadowScript;
+	if (this->getConfig().itemExists(SHADOW_SCRIPT_CONFIG_ITEM_NAME))
+	{
+		shadowScript = this->getConfig().getValue(SHADOW_SCRIPT_CONFIG_ITEM_NAME);
+		found = shadowScript.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
+		if (found != string::npos)
+		{
+			shadowScript.erase(found);
+		}
+	}
+	m_shadowPromote = !shadowScript.empty() &&
+			  this->getConfig().itemExists(SHADOW_PROMOTE_CONFIG_ITEM_NAME) &&
+			  this->getConfig().getValue(SHADOW_PROMOTE_CONFIG_ITEM_NAME).compare("true") == 0;
+	if (m_shadowPromote)
+	{
+		m_pythonScript = shadowScript;
+	}
+
+	// 2) Import Python script
+	if (m_shadowModule && m_shadowScript == m_pythonScript)
+	{
+		// Promotion of the loaded candidate: no import needed
+		m_pModule = m_shadowModule;
+		m_shadowModule = NULL;
+		Py_CLEAR(m_shadowFunc);
+		m_shadowScript.clear();
+
+		Logger::getLogger()->info("Filter '%s' (%s), candidate script '%s' promoted",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_pythonScript.c_str());
+	}
+	else
+	{
+		uint64_t importStart = monotonicNanoseconds();
+		PyObject* pName = PyString_FromString(m_pythonScript.c_str());
+		m_pModule = PyImport_Import(pName);
+		// Delete pName reference
+		Py_CLEAR(pName);
+		this->recordStartup(STARTUP_IMPORT, importStart, monotonicNanoseconds());
+	}
+
+	// Check whether the Python module has been imported
+	if (!m_pModule)
+	{
+		// Failure
+		if (PyErr_Occurred())
+		{
+			this->logErrorMessage();
+		}
+		Logger::getLogger()->fatal("Filter '%s' (%s), cannot import Python 2.7 script "
+					   "'%s' from '%s'",
+					   this->getName().c_str(),
+					   this->getConfig().getName().c_str(),
+					   m_pythonScript.c_str(),
+					   this->getFiltersPath().c_str());
+
+		// This will abort the filter pipeline set up
+		return false;
+	}
+
+	// NOTE:
+	// Filter method to call is the same as filter name
+	// Fetch filter method in loaded object
+	m_pFunc = PyObject_GetAttrString(m_pModule, filterMethod.c_str());
+
+	if (!PyCallable_Check(m_pFunc))
+	{
+		// Failure
+		if (PyErr_Occurred())
+		{
+			this->logErrorMessage();
+		}
+
+		Logger::getLogger()->fatal("Filter %s (%s) error: cannot find Python 2.7 method "
+					   "'%s' in loaded module '%s.py'",
+					   this->getName().c_str(),
+					   this->getConfig().getName().c_str(),
+					   filterMethod.c_str(),
+					   m_pythonScript.c_str());
+		Py_CLEAR(m_pModule);
 		m_pModule = NULL;
 		Py_CLEAR(m_pFunc);
 		m_pFunc = NULL;
 
-		// This will abort the filter pipeline set up
-		return false;
+		// This will abort the filter pipeline set up
+		return false;
+	}
+
+	// Set how script results are passed onwards
+	m_outputMode = OUTPUT_REPLACE;
+	if (this->getConfig().itemExists(OUTPUT_MODE_CONFIG_ITEM_NAME))
+	{
+		string outputMode = this->getConfig().getValue(OUTPUT_MODE_CONFIG_ITEM_NAME);
+		if (outputMode.compare(OUTPUT_MODE_IN_PLACE) == 0)
+		{
+			m_outputMode = OUTPUT_IN_PLACE;
+		}
+		else if (outputMode.compare(OUTPUT_MODE_APPEND) == 0)
+		{
+			m_outputMode = OUTPUT_APPEND;
+		}
+	}
+
+	// Set the thread pool of the parallel conversion
+	unsigned int conversionThreads = 0;
+	if (this->getConfig().itemExists(CONVERSION_THREADS_CONFIG_ITEM_NAME))
+	{
+		conversionThreads = strtoul(this->getConfig().getValue(CONVERSION_THREADS_CONFIG_ITEM_NAME).c_str(),
+					    NULL,
+					    10);
+	}
+	{
+		lock_guard<mutex> guard(m_conversionMutex);
+		if (!conversionThreads ||
+		    (m_conversionPool && m_conversionPool->size() != conversionThreads))
+		{
+			delete m_conversionPool;
+			m_conversionPool = NULL;
+		}
+		if (conversionThreads && !m_conversionPool)
+		{
+			m_conversionPool = new ConversionPool(conversionThreads);
+		}
+	}
+
+	// Set per asset cost attribution sampling
+	m_attributionRate = 0;
+	if (this->getConfig().itemExists(ATTRIBUTION_RATE_CONFIG_ITEM_NAME))
+	{
+		m_attributionRate = strtoul(this->getConfig().getValue(ATTRIBUTION_RATE_CONFIG_ITEM_NAME).c_str(),
+					    NULL,
+					    10);
+	}
+
+	// Set hardware performance counters: switched by the ingest
+	// thread, a batch may be counting
+	bool perfCounters = this->getConfig().itemExists(PERF_COUNTERS_CONFIG_ITEM_NAME) &&
+			    this->getConfig().getValue(PERF_COUNTERS_CONFIG_ITEM_NAME).compare("true") == 0;
+	m_perfRequested.store(perfCounters, std::memory_order_relaxed);
+
+	// Set ingest span tracing
+	bool trace = this->getConfig().itemExists(TRACE_CONFIG_ITEM_NAME) &&
+		     this->getConfig().getValue(TRACE_CONFIG_ITEM_NAME).compare("true") == 0;
+	if (trace)
+	{
+		TraceBuffer::getInstance()->setDataDir(m_dataDir);
+	}
+	else if (m_trace)
+	{
+		// Write the spans collected so far
+		m_trace = false;
+		TraceBuffer::getInstance()->flush();
+	}
+	m_trace = trace;
+
+	// Set function profiling of the script: applied by the
+	// ingest thread, a sampled batch may be running the script
+	unsigned long profileRate = 0;
+	if (this->getConfig().itemExists(PROFILE_RATE_CONFIG_ITEM_NAME))
+	{
+		profileRate = strtoul(this->getConfig().getValue(PROFILE_RATE_CONFIG_ITEM_NAME).c_str(),
+				      NULL,
+				      10);
+	}
+	// The script has been loaded again
+	m_profileReset = true;
+	this->requestProfile(profileRate);
+
+	// Start the runtime control socket: a running one has been
+	// stopped by plugin_reconfigure, without the GIL
+	bool control = this->getConfig().itemExists(CONTROL_SOCKET_CONFIG_ITEM_NAME) &&
+		       this->getConfig().getValue(CONTROL_SOCKET_CONFIG_ITEM_NAME).compare("true") == 0;
+	if (control && !m_control)
+	{
+		m_capturePath = m_dataDir + TRACE_FILES_PATH +
+				StatisticsPage::segmentName(m_categoryName) +
+				"-capture.json";
+		m_control = new ControlSocket(this, m_dataDir, m_categoryName);
+	}
+
+	// Set warm-up of the script
+	m_warmup = this->getConfig().itemExists(WARMUP_CONFIG_ITEM_NAME) &&
+		   this->getConfig().getValue(WARMUP_CONFIG_ITEM_NAME).compare("true") == 0;
+	m_warmupData.clear();
+	if (this->getConfig().itemExists(WARMUP_DATA_CONFIG_ITEM_NAME))
+	{
+		m_warmupData = this->getConfig().getValue(WARMUP_DATA_CONFIG_ITEM_NAME);
+	}
+
+	// Whole configuration as it is
+	string filterConfiguration;
+
+	// Get 'config' filter category configuration
+	if (this->getConfig().itemExists("config"))
+	{
+		filterConfiguration = this->getConfig().getValue("config");
+	}
+	else
+	{
+		// Set empty object
+		filterConfiguration = "{}";
+	}
+
+	/**
+	 * We now pass the filter JSON configuration to the loaded module
+	 */
+	uint64_t configStart = monotonicNanoseconds();
+	bool configured = this->setModuleConfig(m_pModule, filterConfiguration);
+	this->recordStartup(STARTUP_CONFIG, configStart, monotonicNanoseconds());
+	if (!configured)
+	{
+		Py_CLEAR(m_pModule);
+		Py_CLEAR(m_pFunc);
+
+		return false;
+	}
+
+	// Load or promote the candidate script
+	this->configureShadow(filterMethod, filterConfiguration);
+
+	if (!Instrumentation::sampling && (m_shadowModule || m_attributionRate || profileRate))
+	{
+		Logger::getLogger()->warn("Filter '%s' (%s): the candidate script, asset cost "
+					  "attribution and profile are not available, the plugin "
+					  "is built without instrumentation",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str());
+	}
+
+	// Prime the script before live data arrives
+	if (m_warmup)
+	{
+		this->warmUp();
+	}
+
+	return true;
+}
+
+/**
+ * Pass the filter JSON configuration to a loaded module
+ * calling its 'set_filter_config' method, if it exists
+ *
+ * @param module	The loaded module
+ * @param configuration	The JSON configuration
+ * @return		False if set_filter_config fails
+ */
+bool Python27Filter::setModuleConfig(PyObject* module, const string& configuration)
+{
+	PyObject* pConfigFunc = PyObject_GetAttrString(module,
+						       (char *)string(DEFAULT_FILTER_CONFIG_METHOD).c_str());
+
+	// Check whether "set_filter_config" method exists
+	if (PyCallable_Check(pConfigFunc))
+	{
+		// Set configuration object     
+		PyObject* pConfig = PyDict_New();
+		// Add JSON configuration, as string, to "config" key
+		PyObject* pConfigObject = PyString_FromString(configuration.c_str());
+		PyDict_SetItemString(pConfig,
+				     "config",
+				     pConfigObject);
+		Py_CLEAR(pConfigObject);
+		/**
+		 * Call method set_filter_config(c)
+		 * This creates a global JSON configuration
+		 * which will be available when fitering data with "plugin_ingest"
+		 *
+		 * set_filter_config(config) returns 'True'
+		 */
+		PyObject* pSetConfig = PyObject_CallFunctionObjArgs(pConfigFunc,
+								    // arg 1
+								    pConfig,
+								    // end of args
+								    NULL);
+		// Check result
+		if (!pSetConfig ||
+		    !PyBool_Check(pSetConfig) ||
+		    !PyInt_AsLong(pSetConfig))
+		{
+			this->logErrorMessage();
+
+			// Remove temp objects
+			Py_CLEAR(pConfig);
+			Py_CLEAR(pSetConfig);
+
+			// Remove func object
+			Py_CLEAR(pConfigFunc);
+
+			return false;
+		}
+
+		// Remove temp objects
+		Py_CLEAR(pSetConfig);
+		Py_CLEAR(pConfig);
+	}
+	else
+	{
+		// Reset error if function is not present
+		PyErr_Clear();
+	}
+
+	// Remove func object
+	Py_CLEAR(pConfigFunc);
+
+	return true;
+}
+
+/**
+ * Load the candidate script set in 'shadowScript', unless it has
+ * been promoted. The candidate must provide the same filter method
+ * as the configured script.
+ *
+ * A candidate already loaded is kept across reconfigurations,
+ * so that its promotion does not need a new import.
+ *
+ * @param filterMethod	The filter method name
+ * @param configuration	The JSON configuration for set_filter_config
+ */
+void Python27Filter::configureShadow(const string& filterMethod,
+				     const string& configuration)
+{
+	string shadowScript;
+	if (!m_shadowPromote &&
+	    this->getConfig().itemExists(SHADOW_SCRIPT_CONFIG_ITEM_NAME))
+	{
+		shadowScript = this->getConfig().getValue(SHADOW_SCRIPT_CONFIG_ITEM_NAME);
+		size_t found = shadowScript.rfind(PYTHON_SCRIPT_FILENAME_EXTENSION);
+		if (found != string::npos)
+		{
+			shadowScript.erase(found);
+		}
+	}
+
+	m_shadowRate = 0;
+	if (this->getConfig().itemExists(SHADOW_RATE_CONFIG_ITEM_NAME))
+	{
+		m_shadowRate = strtoul(this->getConfig().getValue(SHADOW_RATE_CONFIG_ITEM_NAME).c_str(),
+				       NULL,
+				       10);
+	}
+
+	if (shadowScript != m_shadowScript)
+	{
+		// Candidate removed or changed
+		this->clearShadow();
+		m_shadowStats = ShadowStatistics();
+	}
+
+	if (shadowScript.empty())
+	{
+		return;
+	}
+
+	if (!m_shadowModule)
+	{
+		PyObject* pName = PyString_FromString(shadowScript.c_str());
+		m_shadowModule = PyImport_Import(pName);
+		Py_CLEAR(pName);
+		if (!m_shadowModule)
+		{
+			if (PyErr_Occurred())
+			{
+				this->logErrorMessage();
+			}
+			Logger::getLogger()->error("Filter '%s' (%s), cannot import candidate "
+						   "script '%s' from '%s'",
+						   this->getName().c_str(),
+						   this->getConfig().getName().c_str(),
+						   shadowScript.c_str(),
+						   this->getFiltersPath().c_str());
+			return;
+		}
+		m_shadowScript = shadowScript;
+	}
+
+	Py_CLEAR(m_shadowFunc);
+	m_shadowFunc = PyObject_GetAttrString(m_shadowModule, filterMethod.c_str());
+	if (!PyCallable_Check(m_shadowFunc) ||
+	    !this->setModuleConfig(m_shadowModule, configuration))
+	{
+		if (PyErr_Occurred())
+		{
+			this->logErrorMessage();
+		}
+		Logger::getLogger()->error("Filter '%s' (%s), candidate script '%s' "
+					   "has no usable method '%s'",
+					   this->getName().c_str(),
+					   this->getConfig().getName().c_str(),
+					   shadowScript.c_str(),
+					   filterMethod.c_str());
+		this->clearShadow();
+	}
+}
+
+/**
+ * Start the function profile of the script
+ * if the current batch is sampled
+ *
+ * @return	The profiler to pass to profileStop()
+ *		after the script, NULL if not sampled
+ */
+ScriptProfiler* Python27Filter::profileStart()
+{
+	if (!m_profiler || (++m_profileCounter % m_profileRate) != 0)
+	{
+		return NULL;
+	}
+	m_profiler->start();
+	return m_profiler;
+}
+
+/**
+ * Check whether the current batch is sampled
+ * for the per asset cost attribution
+ *
+ * @return	True if the script has to be timed by asset
+ */
+bool Python27Filter::attributionSample()
+{
+	return m_attributionRate &&
+	       (++m_attributionCounter % m_attributionRate) == 0;
+}
+
+/**
+ * Call the filter method once for each asset of a sampled batch
+ * and time each call: called with the GIL held, after the output
+ * of the script has been passed onwards. The results are dropped.
+ *
+ * @param input		Copy of the script input, created from the
+ *			readings of the batch
+ */
+void Python27Filter::runAttribution(PyObject* input)
+{
+	// Partition the input dicts by asset, in order of first appearance
+	vector<string> assets;
+	unordered_map<string, PyObject *> partitions;
+	for (Py_ssize_t i = 0; i < PyList_GET_SIZE(input); i++)
+	{
+		// Borrowed references
+		PyObject* element = PyList_GET_ITEM(input, i);
+		PyObject* assetCode = PyDict_Check(element) ?
+				      PyDict_GetItemString(element, "asset_code") :
+				      NULL;
+		if (!assetCode || !PyString_Check(assetCode))
+		{
+			continue;
+		}
+		string assetName(PyString_AS_STRING(assetCode), PyString_GET_SIZE(assetCode));
+		unordered_map<string, PyObject *>::iterator it = partitions.find(assetName);
+		if (it == partitions.end())
+		{
+			assets.push_back(assetName);
+			it = partitions.insert(make_pair(assetName, PyList_New(0))).first;
+		}
+		PyList_Append(it->second, element);
+	}
+
+	for (vector<string>::iterator asset = assets.begin();
+				      asset != assets.end();
+				      ++asset)
+	{
+		PyObject* partition = partitions[*asset];
+
+		uint64_t start = monotonicNanoseconds();
+		PyObject* pReturn = PyObject_CallFunction(m_pFunc,
+							  (char *)string("O").c_str(),
+							  partition);
+		uint64_t end = monotonicNanoseconds();
+
+		if (m_assetCosts.size() < ATTRIBUTION_MAX_ASSETS ||
+		    m_assetCosts.find(*asset) != m_assetCosts.end())
+		{
+			AssetCost& cost = m_assetCosts[*asset];
+			cost.batches++;
+			cost.readings += PyList_GET_SIZE(partition);
+			cost.time += end - start;
+		}
+
+		// Errors are those of the configured script, logged
+		// when it ran on the whole batch
+		if (!pReturn)
+		{
+			PyErr_Clear();
+		}
+		Py_CLEAR(pReturn);
+	}
+
+	for (unordered_map<string, PyObject *>::iterator it = partitions.begin();
+							 it != partitions.end();
+							 ++it)
+	{
+		Py_DECREF(it->second);
 	}
+}
 
-	// Whole configuration as it is
-	string filterConfiguration;
+/**
+ * Log the assets with the highest script execution cost,
+ * by total time and by time per reading
+ */
+void Python27Filter::logAssetCosts()
+{
+	if (m_assetCosts.empty())
+	{
+		return;
+	}
 
-	// Get 'config' filter category configuration
-	if (this->getConfig().itemExists("config"))
+	vector<pair<string, AssetCost> > costs(m_assetCosts.begin(), m_assetCosts.end());
+	size_t topN = min(costs.size(), (size_t)ATTRIBUTION_TOP_ASSETS);
+
+	partial_sort(costs.begin(),
+		     costs.begin() + topN,
+		     costs.end(),
+		     [](const pair<string, AssetCost>& a, const pair<string, AssetCost>& b)
+		     {
+			     return a.second.time > b.second.time;
+		     });
+	for (size_t i = 0; i < topN; i++)
 	{
-		filterConfiguration = this->getConfig().getValue("config");
+		Logger::getLogger()->info("Filter '%s' (%s) asset cost by total time #%lu: "
+					  "'%s' %lu us, %lu readings in %lu batches, %.2f us per reading",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  (unsigned long)i + 1,
+					  costs[i].first.c_str(),
+					  (unsigned long)(costs[i].second.time / 1000),
+					  costs[i].second.readings,
+					  costs[i].second.batches,
+					  costs[i].second.readings ?
+					  costs[i].second.time / 1e3 / costs[i].second.readings :
+					  0.0);
 	}
-	else
+
+	partial_sort(costs.begin(),
+		     costs.begin() + topN,
+		     costs.end(),
+		     [](const pair<string, AssetCost>& a, const pair<string, AssetCost>& b)
+		     {
+			     return (double)a.second.time / max(a.second.readings, 1UL) >
+				    (double)b.second.time / max(b.second.readings, 1UL);
+		     });
+	for (size_t i = 0; i < topN; i++)
 	{
-		// Set empty object
-		filterConfiguration = "{}";
+		Logger::getLogger()->info("Filter '%s' (%s) asset cost per reading #%lu: "
+					  "'%s' %.2f us per reading, %lu us in %lu readings",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  (unsigned long)i + 1,
+					  costs[i].first.c_str(),
+					  costs[i].second.readings ?
+					  costs[i].second.time / 1e3 / costs[i].second.readings :
+					  0.0,
+					  (unsigned long)(costs[i].second.time / 1000),
+					  costs[i].second.readings);
 	}
+}
 
-	/**
-	 * We now pass the filter JSON configuration to the loaded module
-	 */
-	PyObject* pConfigFunc = PyObject_GetAttrString(m_pModule,
-						       (char *)string(DEFAULT_FILTER_CONFIG_METHOD).c_str());
+/**
+ * Record the lag between the user timestamp of the readings
+ * and the current time: called just before the readings are
+ * passed onwards
+ *
+ * @param readings	The output readings
+ */
+void Python27Filter::recordFreshness(const vector<Reading *>& readings)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	uint64_t nowMs = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+
+	const string* lastAsset = NULL;
+	Histogram* assetFreshness = NULL;
+	for (vector<Reading *>::const_iterator it = readings.begin();
+					       it != readings.end();
+					       ++it)
+	{
+		struct timeval userTs;
+		(*it)->getUserTimestamp(&userTs);
+		uint64_t userMs = (uint64_t)userTs.tv_sec * 1000 + userTs.tv_usec / 1000;
+		// Readings timestamped in the future are not late
+		uint64_t lag = nowMs > userMs ? nowMs - userMs : 0;
+		m_freshness.add(lag);
+
+		// Readings of the same asset are usually together
+		const string& asset = (*it)->getAssetName();
+		if (!lastAsset || asset != *lastAsset)
+		{
+			lastAsset = &asset;
+			assetFreshness = NULL;
+			unordered_map<string, Histogram>::iterator found = m_assetFreshness.find(asset);
+			if (found != m_assetFreshness.end())
+			{
+				assetFreshness = &found->second;
+			}
+			else if (m_assetFreshness.size() < FRESHNESS_MAX_ASSETS)
+			{
+				assetFreshness = &m_assetFreshness[asset];
+			}
+		}
+		if (assetFreshness)
+		{
+			assetFreshness->add(lag);
+		}
+	}
+}
 
-	// Check whether "set_filter_config" method exists
-	if (PyCallable_Check(pConfigFunc))
+/**
+ * Log the shape of the input batches and the ratio
+ * of output to input readings
+ */
+void Python27Filter::logBatchShape()
+{
+	if (!m_batchShape.readings.count())
 	{
-		// Set configuration object     
-		PyObject* pConfig = PyDict_New();
-		// Add JSON configuration, as string, to "config" key
-		PyObject* pConfigObject = PyString_FromString(filterConfiguration.c_str());
-		PyDict_SetItemString(pConfig,
-				     "config",
-				     pConfigObject);
-		Py_CLEAR(pConfigObject);
-		/**
-		 * Call method set_filter_config(c)
-		 * This creates a global JSON configuration
-		 * which will be available when fitering data with "plugin_ingest"
-		 *
-		 * set_filter_config(config) returns 'True'
-		 */
-		PyObject* pSetConfig = PyObject_CallFunctionObjArgs(pConfigFunc,
-								    // arg 1
-								    pConfig,
-								    // end of args
-								    NULL);
-		// Check result
-		if (!pSetConfig ||
-		    !PyBool_Check(pSetConfig) ||
-		    !PyInt_AsLong(pSetConfig))
+		return;
+	}
+
+	uint64_t values = 0;
+	for (int type = 0; type < VALUE_TYPES; type++)
+	{
+		values += m_batchShape.values[type];
+	}
+	Logger::getLogger()->info("Filter '%s' (%s) batch shape: readings per batch %s; "
+				  "datapoints per reading %s",
+				  this->getName().c_str(),
+				  this->getConfig().getName().c_str(),
+				  m_batchShape.readings.toString().c_str(),
+				  m_batchShape.datapoints.toString().c_str());
+	Logger::getLogger()->info("Filter '%s' (%s) value types: integer %.1f%%, float %.1f%%, "
+				  "string %.1f%%, other %.1f%%; string bytes %s",
+				  this->getName().c_str(),
+				  this->getConfig().getName().c_str(),
+				  values ? 100.0 * m_batchShape.values[VALUE_INTEGER] / values : 0.0,
+				  values ? 100.0 * m_batchShape.values[VALUE_FLOAT] / values : 0.0,
+				  values ? 100.0 * m_batchShape.values[VALUE_STRING] / values : 0.0,
+				  values ? 100.0 * m_batchShape.values[VALUE_OTHER] / values : 0.0,
+				  m_batchShape.stringSize.toString().c_str());
+	if (m_batchShape.outputRatio.count())
+	{
+		Logger::getLogger()->info("Filter '%s' (%s) output readings per 100 input readings: %s",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_batchShape.outputRatio.toString().c_str());
+	}
+}
+
+/**
+ * Log the data freshness of the filter and of the assets
+ * with the highest lag
+ */
+void Python27Filter::logFreshness()
+{
+	if (!m_freshness.count())
+	{
+		return;
+	}
+
+	Logger::getLogger()->info("Filter '%s' (%s) data lag ms: %s",
+				  this->getName().c_str(),
+				  this->getConfig().getName().c_str(),
+				  m_freshness.toString().c_str());
+
+	vector<pair<const string*, const Histogram*> > assets;
+	assets.reserve(m_assetFreshness.size());
+	for (unordered_map<string, Histogram>::const_iterator it = m_assetFreshness.begin();
+							      it != m_assetFreshness.end();
+							      ++it)
+	{
+		assets.push_back(make_pair(&it->first, &it->second));
+	}
+	size_t topN = min(assets.size(), (size_t)FRESHNESS_TOP_ASSETS);
+
+	partial_sort(assets.begin(),
+		     assets.begin() + topN,
+		     assets.end(),
+		     [](const pair<const string*, const Histogram*>& a,
+			const pair<const string*, const Histogram*>& b)
+		     {
+			     return a.second->percentile(99) > b.second->percentile(99);
+		     });
+	for (size_t i = 0; i < topN; i++)
+	{
+		Logger::getLogger()->info("Filter '%s' (%s) data lag by p99 #%lu: '%s' ms: %s",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  (unsigned long)i + 1,
+					  assets[i].first->c_str(),
+					  assets[i].second->toString().c_str());
+	}
+}
+
+/**
+ * Release the candidate script.
+ * Must be called with the GIL held
+ */
+void Python27Filter::clearShadow()
+{
+	Py_CLEAR(m_shadowModule);
+	Py_CLEAR(m_shadowFunc);
+	m_shadowScript.clear();
+}
+
+/**
+ * Check whether the current batch is sampled
+ * for the shadow execution of the candidate script
+ *
+ * @return	True if the candidate has to run on this batch
+ */
+bool Python27Filter::shadowSample()
+{
+	return m_shadowFunc &&
+	       m_shadowRate &&
+	       (++m_shadowCounter % m_shadowRate) == 0;
+}
+
+/**
+ * Run the candidate script on a sampled batch and compare
+ * it with the configured script: called with the GIL held,
+ * after the output of the configured script has been passed onwards.
+ *
+ * @param input		Script input for the candidate, created
+ *			from the same readings of the primary
+ * @param primaryResult	Result of the configured script, NULL on error
+ * @param primaryTime	Execution time of the configured script, in us
+ */
+void Python27Filter::runShadow(PyObject* input,
+			       PyObject* primaryResult,
+			       long primaryTime)
+{
+	if (!m_shadowFunc)
+	{
+		// Removed by a reconfiguration
+		return;
+	}
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	PyObject* pReturn = PyObject_CallFunction(m_shadowFunc,
+						  (char *)string("O").c_str(),
+						  input);
+	gettimeofday(&end, NULL);
+
+	m_shadowStats.batches++;
+	m_shadowStats.primaryTime += primaryTime;
+	m_shadowStats.candidateTime += (end.tv_sec - start.tv_sec) * 1000000 +
+				       (end.tv_usec - start.tv_usec);
+	if (!primaryResult)
+	{
+		m_shadowStats.primaryErrors++;
+	}
+
+	if (!pReturn)
+	{
+		m_shadowStats.candidateErrors++;
+		if (m_shadowStats.candidateErrors <= SHADOW_ERRORS_LOGGED ||
+		    m_shadowStats.candidateErrors % SHADOW_ERRORS_LOG_INTERVAL == 0)
 		{
+			Logger::getLogger()->error("Filter '%s' (%s), candidate script '%s' "
+						   "failed, %lu errors",
+						   this->getName().c_str(),
+						   this->getConfig().getName().c_str(),
+						   m_shadowScript.c_str(),
+						   m_shadowStats.candidateErrors);
 			this->logErrorMessage();
+		}
+		PyErr_Clear();
+		return;
+	}
 
-			Py_CLEAR(m_pModule);
-			delete m_pModule;
-			Py_CLEAR(m_pFunc);
-			delete m_pFunc;
+	// Count the readings which differ
+	if (primaryResult &&
+	    PyList_Check(primaryResult) &&
+	    PyList_Check(pReturn))
+	{
+		Py_ssize_t nPrimary = PyList_GET_SIZE(primaryResult);
+		Py_ssize_t nCandidate = PyList_GET_SIZE(pReturn);
+		unsigned long differences = labs(nPrimary - nCandidate);
+		for (Py_ssize_t i = 0; i < nPrimary && i < nCandidate; i++)
+		{
+			int equal = PyObject_RichCompareBool(PyList_GET_ITEM(primaryResult, i),
+							     PyList_GET_ITEM(pReturn, i),
+							     Py_EQ);
+			if (equal != 1)
+			{
+				PyErr_Clear();
+				differences++;
+			}
+		}
+		if (differences)
+		{
+			m_shadowStats.differentBatches++;
+			m_shadowStats.differentReadings += differences;
+		}
+	}
+	else if (primaryResult)
+	{
+		m_shadowStats.differentBatches++;
+	}
 
-			// Remove temp objects
-			Py_CLEAR(pConfig);
-			Py_CLEAR(pSetConfig);
+	Py_CLEAR(pReturn);
+}
 
-			// Remove func object
-			Py_CLEAR(pConfigFunc);
+/**
+ * Keep a copy of one reading for each of the first assets seen:
+ * they are used as the schema of the warm-up batches.
+ *
+ * @param readings	The input readings
+ */
+void Python27Filter::captureWarmupSample(const vector<Reading *>& readings)
+{
+	if (m_warmupSample.size() >= WARMUP_SAMPLE_ASSETS)
+	{
+		return;
+	}
 
-			return false;
+	for (vector<Reading *>::const_iterator elem = readings.begin();
+					      elem != readings.end() &&
+					      m_warmupSample.size() < WARMUP_SAMPLE_ASSETS;
+					      ++elem)
+	{
+		bool found = false;
+		for (size_t i = 0; i < m_warmupSample.size() && !found; i++)
+		{
+			found = m_warmupSample[i]->getAssetName() == (*elem)->getAssetName();
+		}
+		if (!found)
+		{
+			m_warmupSample.push_back(new Reading(**elem));
 		}
+	}
+}
 
-		// Remove temp objects
-		Py_CLEAR(pSetConfig);
-		Py_CLEAR(pConfig);
+/**
+ * Create a synthetic batch for the warm-up of the script:
+ * from the 'warmupData' configuration item if set, otherwise
+ * from the readings captured in the recent batches.
+ *
+ * @return	New reference to a list of dicts or NULL
+ */
+PyObject* Python27Filter::createWarmupBatch()
+{
+	if (!m_warmupData.empty() && m_warmupData.compare("[]") != 0)
+	{
+		PyObject* pJson = PyImport_ImportModule("json");
+		PyObject* batch = pJson ?
+				  PyObject_CallMethod(pJson,
+						      (char *)"loads",
+						      (char *)"s",
+						      m_warmupData.c_str()) :
+				  NULL;
+		Py_CLEAR(pJson);
+
+		if (!batch || !PyList_Check(batch))
+		{
+			if (PyErr_Occurred())
+			{
+				this->logErrorMessage();
+			}
+			Logger::getLogger()->warn("Filter '%s' (%s), 'warmupData' is not "
+						  "a JSON array of readings",
+						  this->getName().c_str(),
+						  this->getConfig().getName().c_str());
+			Py_CLEAR(batch);
+			return NULL;
+		}
+
+		// Add the attributes the configuration does not set
+		PyObject* now = PyLong_FromUnsignedLong(time(NULL));
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(batch); i++)
+		{
+			PyObject* element = PyList_GET_ITEM(batch, i);
+			if (!PyDict_Check(element))
+			{
+				continue;
+			}
+			const char* keys[] = { "id", "ts", "user_ts" };
+			for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+			{
+				if (!PyDict_GetItemString(element, keys[k]))
+				{
+					PyDict_SetItemString(element, keys[k], now);
+				}
+			}
+		}
+		Py_CLEAR(now);
+
+		return batch;
 	}
-	else
+
+	if (m_warmupSample.empty())
 	{
-		// Reset error if function is not present
-		PyErr_Clear();
+		return NULL;
 	}
 
-	// Remove func object
-	Py_CLEAR(pConfigFunc);
+	// Repeat the captured readings up to the batch size
+	vector<Reading *> readings;
+	readings.reserve(WARMUP_BATCH_SIZE);
+	while (readings.size() < WARMUP_BATCH_SIZE)
+	{
+		readings.push_back(m_warmupSample[readings.size() % m_warmupSample.size()]);
+	}
 
-	return true;
+	return this->createReadingsList(readings);
+}
+
+/**
+ * Warm-up the loaded script: call the filter method with synthetic
+ * batches and discard the results, so that live data does not pay
+ * for lazy imports, first-call caches and cold memory pools.
+ *
+ * Called with the GIL held, after a successful configuration.
+ */
+void Python27Filter::warmUp()
+{
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	int iterations = 0;
+	for (; iterations < WARMUP_ITERATIONS; iterations++)
+	{
+		// The script can change its input: new batch each time
+		PyObject* batch = this->createWarmupBatch();
+		if (!batch)
+		{
+			break;
+		}
+
+		PyObject* pReturn = PyObject_CallFunction(m_pFunc,
+							  (char *)string("O").c_str(),
+							  batch);
+		Py_CLEAR(batch);
+		if (!pReturn)
+		{
+			this->logErrorMessage();
+			break;
+		}
+
+		// Exercise the conversion of the results as well
+		if (m_outputMode == OUTPUT_REPLACE)
+		{
+			vector<Reading *>* newReadings = this->getFilteredReadings(pReturn);
+			if (newReadings)
+			{
+				for (vector<Reading *>::iterator it = newReadings->begin();
+								 it != newReadings->end();
+								 ++it)
+				{
+					delete *it;
+				}
+				delete newReadings;
+			}
+			else if (PyErr_Occurred())
+			{
+				PyErr_Clear();
+			}
+		}
+		Py_CLEAR(pReturn);
+	}
+
+	gettimeofday(&end, NULL);
+	if (iterations)
+	{
+		Logger::getLogger()->info("Filter '%s' (%s), script '%s' warmed up with "
+					  "%d synthetic batches in %ld ms",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_pythonScript.c_str(),
+					  iterations,
+					  (end.tv_sec - start.tv_sec) * 1000 +
+					  (end.tv_usec - start.tv_usec) / 1000);
+	}
+	else
+	{
+		Logger::getLogger()->info("Filter '%s' (%s), no readings to warm up "
+					  "script '%s' with",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_pythonScript.c_str());
+	}
 }
 
 /**
@@ -549,3 +2575,124 @@ bool Python27Filter::reconfigure(const string& newConfig)
 	}
 	return this->configure();
 }
+
+/**
+ * Stop the control socket thread: called without the GIL,
+ * which a command may be waiting for
+ */
+void Python27Filter::stopControl()
+{
+	delete m_control;
+	m_control = NULL;
+}
+
+/**
+ * Apply the profile request of the configuration or of the
+ * control socket: start profiling one batch every N or stop
+ * and log the profile. Called by the ingest thread with the
+ * GIL held, before the script of the batch.
+ */
+void Python27Filter::applyProfileRequest()
+{
+	long rate = m_profileRequest.exchange(-1);
+	if (rate < 0)
+	{
+		return;
+	}
+	if (rate == 0)
+	{
+		this->logProfile();
+		delete m_profiler;
+		m_profiler = NULL;
+		m_profileRate = 0;
+		return;
+	}
+	if (!m_profiler)
+	{
+		m_profiler = new ScriptProfiler();
+	}
+	else if (m_profileReset)
+	{
+		m_profiler->reset();
+	}
+	m_profileReset = false;
+	m_profileRate = rate;
+	m_profileCounter = 0;
+}
+
+/**
+ * Return the JSON representation of a Python object, values
+ * JSON does not support are written with their repr().
+ * Called with the GIL held.
+ *
+ * @param object	The object, may be NULL
+ * @return		The JSON text, null on error
+ */
+string Python27Filter::captureJson(PyObject* object)
+{
+	string json = "null";
+	if (!object)
+	{
+		return json;
+	}
+
+	PyObject* module = PyImport_ImportModule("json");
+	PyObject* dumps = module ? PyObject_GetAttrString(module, "dumps") : NULL;
+	PyObject* args = PyTuple_Pack(1, object);
+	PyObject* kwargs = PyDict_New();
+	if (dumps && args && kwargs &&
+	    PyDict_SetItemString(kwargs,
+				 "default",
+				 PyDict_GetItemString(PyEval_GetBuiltins(), "repr")) == 0)
+	{
+		PyObject* text = PyObject_Call(dumps, args, kwargs);
+		if (text && PyString_Check(text))
+		{
+			json = PyString_AsString(text);
+		}
+		Py_CLEAR(text);
+	}
+	if (PyErr_Occurred())
+	{
+		Logger::getLogger()->warn("Filter '%s' (%s): unable to capture a batch as JSON",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str());
+		PyErr_Clear();
+	}
+	Py_CLEAR(kwargs);
+	Py_CLEAR(args);
+	Py_CLEAR(dumps);
+	Py_CLEAR(module);
+	return json;
+}
+
+/**
+ * Append a captured batch to the capture file,
+ * one JSON object per line
+ *
+ * @param input		The script input, as JSON
+ * @param output	The script result, NULL on error
+ */
+void Python27Filter::writeCapture(const string& input, PyObject* output)
+{
+	// The logs directory may not exist yet
+	mkdir((m_dataDir + "/logs").c_str(), 0755);
+	mkdir((m_dataDir + TRACE_FILES_PATH).c_str(), 0755);
+
+	FILE* file = fopen(m_capturePath.c_str(), "a");
+	if (!file)
+	{
+		Logger::getLogger()->warn("Filter '%s' (%s): unable to write capture file '%s': %s",
+					  this->getName().c_str(),
+					  this->getConfig().getName().c_str(),
+					  m_capturePath.c_str(),
+					  strerror(errno));
+		return;
+	}
+	fprintf(file,
+		"{\"batch\": %lu, \"input\": %s, \"output\": %s}\n",
+		++m_captureBatches,
+		input.c_str(),
+		this->captureJson(output).c_str());
+	fclose(file);
+}
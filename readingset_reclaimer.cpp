@@ -0,0 +1,142 @@
+/*
+ * Fledge "Python 2.7" filter deferred ReadingSet reclamation.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <logger.h>
+
+#include "readingset_reclaimer.h"
+
+// Above this number of pending sets the caller frees the data inline
+#define RECLAIMER_MAX_PENDING 64
+
+using namespace std;
+
+ReadingSetReclaimer* ReadingSetReclaimer::m_instance = NULL;
+unsigned int ReadingSetReclaimer::m_users = 0;
+mutex ReadingSetReclaimer::m_instanceMutex;
+
+/**
+ * Get the shared reclaimer, creating it on first use
+ *
+ * @return	The ReadingSetReclaimer instance
+ */
+ReadingSetReclaimer* ReadingSetReclaimer::acquire()
+{
+	lock_guard<mutex> guard(m_instanceMutex);
+	if (!m_instance)
+	{
+		m_instance = new ReadingSetReclaimer();
+	}
+	m_users++;
+	return m_instance;
+}
+
+/**
+ * Release the shared reclaimer: the last user
+ * destroys the pending sets and stops the thread
+ */
+void ReadingSetReclaimer::release()
+{
+	lock_guard<mutex> guard(m_instanceMutex);
+	if (m_users && --m_users == 0)
+	{
+		delete m_instance;
+		m_instance = NULL;
+	}
+}
+
+/**
+ * Constructor: start the background thread
+ */
+ReadingSetReclaimer::ReadingSetReclaimer() : m_depth(0),
+					     m_running(true),
+					     m_thread(&ReadingSetReclaimer::run, this)
+{
+}
+
+/**
+ * Destructor: stop the background thread
+ * after all the pending sets have been destroyed
+ */
+ReadingSetReclaimer::~ReadingSetReclaimer()
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_running = false;
+		m_cv.notify_one();
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/**
+ * Hand a consumed ReadingSet over for destruction.
+ *
+ * If the background thread is not keeping up
+ * the set is destroyed by the caller.
+ *
+ * @param readingSet	The ReadingSet to destroy
+ */
+void ReadingSetReclaimer::reclaim(ReadingSet* readingSet)
+{
+	if (!readingSet)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(m_mutex);
+		if (m_queue.size() < RECLAIMER_MAX_PENDING)
+		{
+			m_queue.push_back(readingSet);
+			m_depth.store(m_queue.size(), memory_order_relaxed);
+			m_cv.notify_one();
+			return;
+		}
+	}
+
+	delete readingSet;
+}
+
+/**
+ * Background thread: destroy queued ReadingSets.
+ *
+ * The thread runs with SCHED_IDLE policy so that
+ * it only gets CPU time nobody else is using.
+ */
+void ReadingSetReclaimer::run()
+{
+	struct sched_param param;
+	param.sched_priority = 0;
+	if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0)
+	{
+		Logger::getLogger()->warn("Unable to lower the priority of the "
+					  "python27 ReadingSet reclaimer thread");
+	}
+
+	unique_lock<mutex> lck(m_mutex);
+	while (m_running || !m_queue.empty())
+	{
+		m_cv.wait(lck, [this] { return !m_running || !m_queue.empty(); });
+		while (!m_queue.empty())
+		{
+			ReadingSet* readingSet = m_queue.front();
+			m_queue.pop_front();
+			m_depth.store(m_queue.size(), memory_order_relaxed);
+
+			// Destroy outside the lock
+			lck.unlock();
+			delete readingSet;
+			lck.lock();
+		}
+	}
+}
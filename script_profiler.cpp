@@ -0,0 +1,290 @@
+/*
+ * Fledge "Python 2.7" filter script function profiler.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "script_profiler.h"
+
+using namespace std;
+
+// Profiler of the calling thread, between start() and stop()
+static __thread ScriptProfiler* activeProfiler = NULL;
+
+/**
+ * Return the current time of the monotonic clock
+ *
+ * @return	Nanoseconds
+ */
+static inline uint64_t profileClock()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Constructor
+ */
+ScriptProfiler::ScriptProfiler() : m_batches(0)
+{
+}
+
+/**
+ * Destructor: called with the GIL held
+ */
+ScriptProfiler::~ScriptProfiler()
+{
+	this->release();
+}
+
+/**
+ * Release the code objects referenced by the statistics
+ */
+void ScriptProfiler::release()
+{
+	for (unordered_map<const void*, FunctionStatistics>::iterator it = m_functions.begin();
+								      it != m_functions.end();
+								      ++it)
+	{
+		Py_CLEAR(it->second.code);
+	}
+}
+
+/**
+ * Install the profile hook in the calling thread:
+ * called with the GIL held
+ */
+void ScriptProfiler::start()
+{
+	m_stack.clear();
+	activeProfiler = this;
+	PyEval_SetProfile(ScriptProfiler::profile, NULL);
+}
+
+/**
+ * Remove the profile hook: called with the GIL held.
+ * Functions still on the stack, if any, are not counted.
+ */
+void ScriptProfiler::stop()
+{
+	PyEval_SetProfile(NULL, NULL);
+	activeProfiler = NULL;
+	for (vector<StackFrame>::iterator it = m_stack.begin();
+					  it != m_stack.end();
+					  ++it)
+	{
+		it->function->active--;
+	}
+	m_stack.clear();
+	m_batches++;
+}
+
+/**
+ * Remove all the collected statistics:
+ * called when the script is loaded again
+ */
+void ScriptProfiler::reset()
+{
+	this->release();
+	m_functions.clear();
+	m_stack.clear();
+	m_batches = 0;
+}
+
+/**
+ * The interpreter profile hook
+ *
+ * @param object	Unused
+ * @param frame		The current Python frame
+ * @param what		The profile event
+ * @param arg		The built-in function of C events
+ * @return		Always 0
+ */
+int ScriptProfiler::profile(PyObject* object,
+			    PyFrameObject* frame,
+			    int what,
+			    PyObject* arg)
+{
+	ScriptProfiler* profiler = activeProfiler;
+	if (!profiler)
+	{
+		return 0;
+	}
+
+	switch (what)
+	{
+		case PyTrace_CALL:
+			profiler->enter(frame->f_code, frame, NULL);
+			break;
+		case PyTrace_C_CALL:
+			if (PyCFunction_Check(arg))
+			{
+				profiler->enter(((PyCFunctionObject *)arg)->m_ml, NULL, arg);
+			}
+			break;
+		case PyTrace_RETURN:
+			profiler->leave();
+			break;
+		case PyTrace_C_RETURN:
+		case PyTrace_C_EXCEPTION:
+			if (PyCFunction_Check(arg))
+			{
+				profiler->leave();
+			}
+			break;
+		default:
+			break;
+	}
+	return 0;
+}
+
+/**
+ * A function has been called
+ *
+ * @param key		The code object or method definition
+ * @param frame		The frame of a Python function
+ * @param function	The built-in function object
+ */
+void ScriptProfiler::enter(const void* key, PyFrameObject* frame, PyObject* function)
+{
+	FunctionStatistics& statistics = m_functions[key];
+	if (statistics.name.empty())
+	{
+		// First call: pstats style function name
+		char name[256];
+		statistics.code = NULL;
+		if (frame)
+		{
+			PyCodeObject* code = frame->f_code;
+			// Kept while it is a key
+			Py_INCREF(code);
+			statistics.code = (PyObject *)code;
+			snprintf(name,
+				 sizeof(name),
+				 "%s:%d(%s)",
+				 PyString_AsString(code->co_filename),
+				 code->co_firstlineno,
+				 PyString_AsString(code->co_name));
+		}
+		else
+		{
+			PyCFunctionObject* builtin = (PyCFunctionObject *)function;
+			if (builtin->m_self && !PyModule_Check(builtin->m_self))
+			{
+				snprintf(name,
+					 sizeof(name),
+					 "{method '%s' of '%s' objects}",
+					 builtin->m_ml->ml_name,
+					 Py_TYPE(builtin->m_self)->tp_name);
+			}
+			else if (builtin->m_module && PyString_Check(builtin->m_module))
+			{
+				snprintf(name,
+					 sizeof(name),
+					 "{%s.%s}",
+					 PyString_AsString(builtin->m_module),
+					 builtin->m_ml->ml_name);
+			}
+			else
+			{
+				snprintf(name,
+					 sizeof(name),
+					 "{built-in method %s}",
+					 builtin->m_ml->ml_name);
+			}
+		}
+		statistics.name = name;
+		statistics.calls = 0;
+		statistics.inclusive = 0;
+		statistics.exclusive = 0;
+		statistics.active = 0;
+	}
+
+	statistics.calls++;
+	statistics.active++;
+
+	StackFrame stackFrame;
+	stackFrame.function = &statistics;
+	stackFrame.children = 0;
+	stackFrame.start = profileClock();
+	m_stack.push_back(stackFrame);
+}
+
+/**
+ * The function on top of the stack has returned
+ */
+void ScriptProfiler::leave()
+{
+	if (m_stack.empty())
+	{
+		// Returning from a call made before start()
+		return;
+	}
+
+	uint64_t elapsed = profileClock() - m_stack.back().start;
+	StackFrame& stackFrame = m_stack.back();
+	FunctionStatistics* statistics = stackFrame.function;
+
+	statistics->exclusive += elapsed - stackFrame.children;
+	// Recursive calls are included in the outermost one
+	if (--statistics->active == 0)
+	{
+		statistics->inclusive += elapsed;
+	}
+	m_stack.pop_back();
+
+	if (!m_stack.empty())
+	{
+		m_stack.back().children += elapsed;
+	}
+}
+
+/**
+ * Return a text report of the functions with the highest
+ * exclusive time, with the columns of a pstats report
+ *
+ * @param functions	The number of functions to report
+ * @return		One line per function, after a header line
+ */
+string ScriptProfiler::report(unsigned int functions) const
+{
+	vector<const FunctionStatistics *> sorted;
+	sorted.reserve(m_functions.size());
+	for (unordered_map<const void*, FunctionStatistics>::const_iterator it = m_functions.begin();
+									    it != m_functions.end();
+									    ++it)
+	{
+		sorted.push_back(&it->second);
+	}
+	sort(sorted.begin(),
+	     sorted.end(),
+	     [](const FunctionStatistics* a, const FunctionStatistics* b)
+	     {
+		return a->exclusive > b->exclusive;
+	     });
+
+	string report = "   ncalls  tottime  percall  cumtime  percall filename:lineno(function)";
+	char line[400];
+	for (unsigned int i = 0; i < sorted.size() && i < functions; i++)
+	{
+		const FunctionStatistics* statistics = sorted[i];
+		snprintf(line,
+			 sizeof(line),
+			 "\n%9lu %8.3f %8.6f %8.3f %8.6f %s",
+			 (unsigned long)statistics->calls,
+			 statistics->exclusive / 1e9,
+			 statistics->exclusive / 1e9 / statistics->calls,
+			 statistics->inclusive / 1e9,
+			 statistics->inclusive / 1e9 / statistics->calls,
+			 statistics->name.c_str());
+		report += line;
+	}
+	return report;
+}
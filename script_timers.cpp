@@ -0,0 +1,227 @@
+/*
+ * Fledge "Python 2.7" filter script timers.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <time.h>
+
+#include "script_timers.h"
+
+using namespace std;
+
+// Timers of the script running on the calling thread
+static __thread ScriptTimers* activeTimers = NULL;
+
+/**
+ * Return the current time of the monotonic clock
+ *
+ * @return	Nanoseconds
+ */
+static inline uint64_t timerClock()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Python timer object, a context manager
+ * returned by fledge_timing.timed(name)
+ */
+typedef struct
+{
+	PyObject_HEAD
+	// Interned section name
+	PyObject*	name;
+	uint64_t	start;
+} TimerObject;
+
+static void timerDealloc(TimerObject* self)
+{
+	Py_XDECREF(self->name);
+	PyObject_Del(self);
+}
+
+static PyObject* timerEnter(TimerObject* self, PyObject* unused)
+{
+	self->start = timerClock();
+	Py_INCREF(self);
+	return (PyObject *)self;
+}
+
+static PyObject* timerExit(TimerObject* self, PyObject* args)
+{
+	uint64_t end = timerClock();
+	ScriptTimers* timers = activeTimers;
+	if (timers && self->start)
+	{
+		timers->record(self->name, end - self->start);
+	}
+	self->start = 0;
+	// Exceptions raised in the section are not suppressed
+	Py_RETURN_FALSE;
+}
+
+static PyMethodDef timerMethods[] = {
+	{"__enter__", (PyCFunction)timerEnter, METH_NOARGS, "Start timing the section"},
+	{"__exit__", (PyCFunction)timerExit, METH_VARARGS, "Record the section time"},
+	{NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject timerType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	SCRIPT_TIMERS_MODULE ".Timer",	// tp_name
+	sizeof(TimerObject),		// tp_basicsize
+	0,				// tp_itemsize
+	(destructor)timerDealloc,	// tp_dealloc
+	0,				// tp_print
+	0,				// tp_getattr
+	0,				// tp_setattr
+	0,				// tp_compare
+	0,				// tp_repr
+	0,				// tp_as_number
+	0,				// tp_as_sequence
+	0,				// tp_as_mapping
+	0,				// tp_hash
+	0,				// tp_call
+	0,				// tp_str
+	0,				// tp_getattro
+	0,				// tp_setattro
+	0,				// tp_as_buffer
+	Py_TPFLAGS_DEFAULT,		// tp_flags
+	"Section timer, use it in a with statement",	// tp_doc
+	0,				// tp_traverse
+	0,				// tp_clear
+	0,				// tp_richcompare
+	0,				// tp_weaklistoffset
+	0,				// tp_iter
+	0,				// tp_iternext
+	timerMethods			// tp_methods
+};
+
+/**
+ * fledge_timing.timed(name): return a timer for a named section
+ */
+static PyObject* timed(PyObject* module, PyObject* args)
+{
+	PyObject* name;
+	if (!PyArg_ParseTuple(args, "O:timed", &name))
+	{
+		return NULL;
+	}
+
+	if (PyUnicode_Check(name))
+	{
+		name = PyUnicode_AsUTF8String(name);
+		if (!name)
+		{
+			return NULL;
+		}
+	}
+	else if (PyString_Check(name))
+	{
+		Py_INCREF(name);
+	}
+	else
+	{
+		PyErr_SetString(PyExc_TypeError, "timed() name must be a string");
+		return NULL;
+	}
+	// Literal names are already interned: this is a lookup
+	PyString_InternInPlace(&name);
+
+	TimerObject* timer = PyObject_New(TimerObject, &timerType);
+	if (!timer)
+	{
+		Py_DECREF(name);
+		return NULL;
+	}
+	timer->name = name;
+	timer->start = 0;
+	return (PyObject *)timer;
+}
+
+static PyMethodDef moduleMethods[] = {
+	{"timed", timed, METH_VARARGS, "Return a context manager timing a named section"},
+	{NULL, NULL, 0, NULL}
+};
+
+/**
+ * Create the fledge_timing module, if not done yet:
+ * called with the GIL held after the interpreter initialisation
+ */
+void ScriptTimers::initModule()
+{
+	// Borrowed reference
+	if (PyDict_GetItemString(PyImport_GetModuleDict(), SCRIPT_TIMERS_MODULE))
+	{
+		return;
+	}
+
+	if (PyType_Ready(&timerType) < 0)
+	{
+		PyErr_Clear();
+		return;
+	}
+	// Borrowed reference, the module is kept in sys.modules
+	PyObject* module = Py_InitModule3(SCRIPT_TIMERS_MODULE,
+					  moduleMethods,
+					  "Timing of filter script sections");
+	if (module)
+	{
+		Py_INCREF(&timerType);
+		PyModule_AddObject(module, "Timer", (PyObject *)&timerType);
+	}
+}
+
+/**
+ * Set the timers recording the sections timed on the calling thread
+ *
+ * @param timers	The timers of the filter calling its
+ *			script, NULL after the call
+ */
+void ScriptTimers::activate(ScriptTimers* timers)
+{
+	activeTimers = timers;
+}
+
+/**
+ * Record the time of a section: called with the GIL held
+ *
+ * @param name		The interned section name
+ * @param nanoseconds	The section time
+ */
+void ScriptTimers::record(PyObject* name, uint64_t nanoseconds)
+{
+	unordered_map<PyObject*, Timer>::iterator it = m_timers.find(name);
+	if (it == m_timers.end())
+	{
+		if (m_timers.size() >= SCRIPT_TIMERS_MAX_NAMES)
+		{
+			return;
+		}
+		Py_INCREF(name);
+		Timer& timer = m_timers[name];
+		timer.name = PyString_AsString(name);
+		timer.histogram.add(nanoseconds);
+		return;
+	}
+	it->second.histogram.add(nanoseconds);
+}
+
+/**
+ * Remove all the timers: called with the GIL held
+ */
+void ScriptTimers::clear()
+{
+	for (unordered_map<PyObject*, Timer>::iterator it = m_timers.begin();
+						       it != m_timers.end();
+						       ++it)
+	{
+		Py_DECREF(it->first);
+	}
+	m_timers.clear();
+}
@@ -0,0 +1,101 @@
+/*
+ * Fledge "Python 2.7" filter shared memory statistics.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <new>
+
+#include <logger.h>
+
+#include "statistics_page.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+/**
+ * Constructor: create and initialise the statistics segment,
+ * readable by the user of the filter only. Without counters
+ * the statistics are kept in the process memory.
+ *
+ * @param filterName	The filter category name
+ */
+StatisticsPage::StatisticsPage(const string& filterName) :
+				m_name(segmentName(filterName)),
+				m_layout(NULL),
+				m_shared(false)
+{
+	void* memory = NULL;
+	int fd = Instrumentation::counters ?
+		 shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0600) :
+		 -1;
+	if (fd >= 0)
+	{
+		// A segment left by an earlier process keeps its mode
+		if (fchmod(fd, 0600) == 0 &&
+		    ftruncate(fd, sizeof(StatisticsLayout)) == 0)
+		{
+			memory = mmap(NULL,
+				      sizeof(StatisticsLayout),
+				      PROT_READ | PROT_WRITE,
+				      MAP_SHARED,
+				      fd,
+				      0);
+			if (memory == MAP_FAILED)
+			{
+				memory = NULL;
+			}
+		}
+		close(fd);
+	}
+
+	if (memory)
+	{
+		m_shared = true;
+	}
+	else
+	{
+		if (Instrumentation::counters)
+		{
+			Logger::getLogger()->warn("Unable to create statistics shared memory '%s': %s",
+						  m_name.c_str(),
+						  strerror(errno));
+			shm_unlink(m_name.c_str());
+		}
+		memory = new char[sizeof(StatisticsLayout)];
+	}
+
+	memset(memory, 0, sizeof(StatisticsLayout));
+	m_layout = new (memory) StatisticsLayout;
+	m_layout->size = sizeof(StatisticsLayout);
+	m_layout->pid = getpid();
+	strncpy(m_layout->filterName, filterName.c_str(), sizeof(m_layout->filterName) - 1);
+	m_layout->version = STATISTICS_PAGE_VERSION;
+	// Magic is set last: readers ignore the segment until then
+	atomic_thread_fence(memory_order_release);
+	m_layout->magic = STATISTICS_PAGE_MAGIC;
+}
+
+/**
+ * Destructor: remove the statistics segment
+ */
+StatisticsPage::~StatisticsPage()
+{
+	if (m_shared)
+	{
+		munmap(m_layout, sizeof(StatisticsLayout));
+		shm_unlink(m_name.c_str());
+	}
+	else
+	{
+		delete[] (char *)m_layout;
+	}
+}
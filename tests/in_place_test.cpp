@@ -0,0 +1,128 @@
+/*
+ * Fledge "Python 2.7" filter update in place test.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Batches run through the filter
+#define IN_PLACE_BATCHES 1000
+
+// Drops the third reading, updates the first one and returns
+// the second one twice
+static const char* inPlaceScript =
+	"def inplace(readings):\n"
+	"    readings[0]['reading']['value'] = 42\n"
+	"    return [readings[0], readings[1], readings[1]]\n";
+
+static const char* outputModeItem =
+	", \"outputMode\": {\"description\": \"\", \"type\": \"enumeration\", "
+		"\"options\": [\"Replace\", \"Update in place\", \"Append\"], "
+		"\"default\": \"Update in place\", \"value\": \"Update in place\"}";
+
+/**
+ * Create a batch of three readings, assets a, b and c
+ * with an integer datapoint value of 1, 2 and 3
+ *
+ * @return	New ReadingSet
+ */
+static ReadingSet* createInput()
+{
+	static const char* assets[] = { "a", "b", "c" };
+	vector<Reading *> readings;
+	for (long i = 0; i < 3; i++)
+	{
+		DatapointValue value(i + 1);
+		readings.push_back(new Reading(assets[i], new Datapoint("value", value)));
+	}
+	return new ReadingSet(&readings);
+}
+
+/**
+ * Check the output of one batch
+ *
+ * @param output	The filter output
+ * @return		False if the output is not the expected one
+ */
+static bool checkOutput(ReadingSet* output)
+{
+	static const char* assets[] = { "a", "b", "b" };
+	static const long values[] = { 42, 2, 2 };
+
+	if (!output || output->getCount() != 3)
+	{
+		fprintf(stderr, "Expected 3 readings, got %lu\n", output ? output->getCount() : 0);
+		return false;
+	}
+	const vector<Reading *>& readings = output->getAllReadings();
+	if (readings[1] == readings[2])
+	{
+		fprintf(stderr, "The duplicated reading is not a copy\n");
+		return false;
+	}
+	for (size_t i = 0; i < readings.size(); i++)
+	{
+		Datapoint* value = readings[i]->getDatapoint("value");
+		if (readings[i]->getAssetName() != assets[i] ||
+		    !value ||
+		    value->getData().toInt() != values[i])
+		{
+			fprintf(stderr, "Reading %zu: %s\n", i, readings[i]->toJSON().c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Run batches through a filter updating the readings in place,
+ * with a script dropping, keeping and duplicating readings.
+ * Each output is deleted: a reading deleted twice or not
+ * deleted is reported by the memory checkers.
+ */
+int main()
+{
+	if (!setupBenchmark())
+	{
+		return 2;
+	}
+	string script = writeScript("inplace", inPlaceScript);
+	if (script.empty())
+	{
+		return 2;
+	}
+
+	BenchmarkFilter* filter = new BenchmarkFilter("test-in-place", script, outputModeItem);
+	if (!filter->ready())
+	{
+		delete filter;
+		return 2;
+	}
+	filter->keepOutput(true);
+
+	int failed = 0;
+	for (int batch = 0; batch < IN_PLACE_BATCHES && !failed; batch++)
+	{
+		filter->ingest(createInput());
+		ReadingSet* output = filter->takeOutput();
+		if (!checkOutput(output))
+		{
+			fprintf(stderr, "Batch %d failed\n", batch);
+			failed = 1;
+		}
+		delete output;
+	}
+	delete filter;
+
+	printf("Update in place: %s\n", failed ? "FAILED" : "passed");
+	return failed;
+}
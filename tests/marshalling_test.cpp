@@ -0,0 +1,742 @@
+/*
+ * Fledge "Python 2.7" filter marshalling test.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <unistd.h>
+#include <limits.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Python.h>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Batches run through each script and output mode, if not given
+#define MARSHALLING_BATCHES 200
+// Largest generated batch
+#define MARSHALLING_MAX_READINGS 40
+// Batches converted by the thread pool, see PARALLEL_CONVERSION_MIN_READINGS
+#define MARSHALLING_PARALLEL_READINGS 2048
+// Largest generated reading
+#define MARSHALLING_MAX_DATAPOINTS 8
+
+// Output modes of the filter, the parallel conversion
+// is run with large batches
+typedef struct
+{
+	const char*	name;
+	const char*	outputMode;
+	const char*	conversionThreads;
+} TestMode;
+
+static const TestMode modes[] = {
+	{ "Replace",		"Replace",		"0" },
+	{ "Update in place",	"Update in place",	"0" },
+	{ "Append",		"Append",		"0" },
+	{ "Replace parallel",	"Replace",		"4" }
+};
+#define MODES (sizeof(modes) / sizeof(modes[0]))
+
+// Each script keeps a copy of its last input, for the input check
+static const char* recordScript =
+	"import copy\n"
+	"\n"
+	"last_input = None\n"
+	"\n"
+	"def record(readings):\n"
+	"    global last_input\n"
+	"    last_input = copy.deepcopy(readings)\n"
+	"\n";
+
+typedef struct
+{
+	const char*	name;
+	const char*	body;
+} TestScript;
+
+static const TestScript scripts[] = {
+	{
+		"drop",
+		"def drop(readings):\n"
+		"    record(readings)\n"
+		"    return [elem for i, elem in enumerate(readings) if i % 3 != 1]\n"
+	},
+	{
+		"mutate",
+		"def mutate(readings):\n"
+		"    record(readings)\n"
+		"    for i, elem in enumerate(readings):\n"
+		"        reading = elem['reading']\n"
+		"        if i % 7 == 3:\n"
+		"            reading.clear()\n"
+		"            continue\n"
+		"        for key in sorted(reading):\n"
+		"            value = reading[key]\n"
+		"            if isinstance(value, (int, long)):\n"
+		"                reading[key] = value * 3 + 1\n"
+		"            elif isinstance(value, float):\n"
+		"                reading[key] = value / 2\n"
+		"            else:\n"
+		"                reading[key] = value[::-1] + 'x'\n"
+		"        if len(reading) > 1:\n"
+		"            del reading[sorted(reading)[0]]\n"
+		"        reading['added'] = len(reading)\n"
+		"        elem['asset_code'] = elem['asset_code'] + '-m'\n"
+		"    return readings\n"
+	},
+	{
+		"add",
+		"def add(readings):\n"
+		"    record(readings)\n"
+		"    added = [{'asset_code': 'added', 'reading': {'count': len(readings), 'ratio': 0.5}},\n"
+		"             {'asset_code': 'added', 'reading': {'label': 'new \"reading\"'}}]\n"
+		"    return readings + added\n"
+	},
+	{
+		"reorder",
+		"def reorder(readings):\n"
+		"    record(readings)\n"
+		"    return list(reversed(readings))\n"
+	}
+};
+#define SCRIPTS (sizeof(scripts) / sizeof(scripts[0]))
+
+// Names with spaces, quotes, separators and non ASCII characters
+static const char* assetNames[] = {
+	"pump", "pump 1", "", "débit", "line/3", "quoted \"asset\"", "back\\slash",
+	"a_very_long_asset_name_used_to_check_that_long_names_are_not_truncated_"
+	"by_any_fixed_size_buffer_of_the_conversions_0123456789"
+};
+static const char* datapointNames[] = {
+	"value", "temperature", "flow rate", "niveau_élevé", "x", "quoted \"dp\"",
+	"state", "count", "ratio", "message"
+};
+
+static const long integerEdges[] = {
+	0, 1, -1, INT_MAX, (long)INT_MAX + 1, INT_MIN, LONG_MAX, LONG_MIN
+};
+static const double floatEdges[] = {
+	0.0, -0.0, 0.1, -1.5, 1e308, -1e308, 5e-324, DBL_EPSILON
+};
+static const char* stringEdges[] = {
+	"", "running", "with \"quotes\"", "back\\slash", "line\nbreak\ttab",
+	"température", "{\"json\": [1, 2]}"
+};
+
+/**
+ * Random batches of readings covering every datapoint type
+ * passed to the scripts and their edge values
+ */
+class ReadingGenerator
+{
+	public:
+		ReadingGenerator(unsigned long seed) : m_random(seed) {};
+
+		ReadingSet*	batch(unsigned long minReadings, unsigned long maxReadings);
+
+	private:
+		unsigned long	pick(unsigned long count)
+		{
+			return uniform_int_distribution<unsigned long>(0, count - 1)(m_random);
+		};
+		DatapointValue*	value(int depth);
+
+	private:
+		mt19937_64	m_random;
+};
+
+/**
+ * Create a random datapoint value
+ *
+ * @param depth		Nesting depth of dict values
+ * @return		New DatapointValue
+ */
+DatapointValue* ReadingGenerator::value(int depth)
+{
+	switch (pick(depth ? 6 : 7))
+	{
+		case 0:
+			return new DatapointValue(integerEdges[pick(sizeof(integerEdges) / sizeof(long))]);
+		case 1:
+			return new DatapointValue((long)m_random());
+		case 2:
+			return new DatapointValue(floatEdges[pick(sizeof(floatEdges) / sizeof(double))]);
+		case 3:
+			return new DatapointValue(uniform_real_distribution<double>(-1e6, 1e6)(m_random));
+		case 4:
+			return new DatapointValue(string(stringEdges[pick(sizeof(stringEdges) / sizeof(char *))]));
+		case 5:
+		{
+			if (pick(4) == 0)
+			{
+				return new DatapointValue(string(4096, 'm'));
+			}
+			vector<double> values(pick(16));
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				values[i] = uniform_real_distribution<double>(-1e3, 1e3)(m_random);
+			}
+			return new DatapointValue(values);
+		}
+		default:
+		{
+			vector<Datapoint *>* children = new vector<Datapoint *>();
+			for (unsigned long i = pick(3) + 1; i; i--)
+			{
+				DatapointValue* child = value(depth + 1);
+				char name[16];
+				snprintf(name, sizeof(name), "child%lu", i);
+				children->push_back(new Datapoint(name, *child));
+				delete child;
+			}
+			return new DatapointValue(children, true);
+		}
+	}
+}
+
+/**
+ * Create a random batch of readings
+ *
+ * @param minReadings	The smallest batch
+ * @param maxReadings	The largest batch
+ * @return		New ReadingSet
+ */
+ReadingSet* ReadingGenerator::batch(unsigned long minReadings, unsigned long maxReadings)
+{
+	vector<Reading *> readings;
+	for (unsigned long i = minReadings + pick(maxReadings - minReadings + 1); i; i--)
+	{
+		vector<Datapoint *> values;
+		unsigned long first = pick(sizeof(datapointNames) / sizeof(char *));
+		unsigned long count = pick(MARSHALLING_MAX_DATAPOINTS) + 1;
+		for (unsigned long j = 0; j < count && j < sizeof(datapointNames) / sizeof(char *); j++)
+		{
+			// Distinct names in a reading
+			const char* name = datapointNames[(first + j) % (sizeof(datapointNames) / sizeof(char *))];
+			DatapointValue* data = value(0);
+			values.push_back(new Datapoint(name, *data));
+			delete data;
+		}
+		Reading* reading = new Reading(assetNames[pick(sizeof(assetNames) / sizeof(char *))], values);
+		reading->setId(m_random() >> 1);
+		reading->setTimestamp(1700000000 + pick(100000000));
+		reading->setUserTimestamp(1700000000 + pick(100000000));
+		readings.push_back(reading);
+	}
+	return new ReadingSet(&readings);
+}
+
+/**
+ * Reference conversion of readings into the script input:
+ * a list of dicts, without any cached or shared object
+ *
+ * @param readings	The input readings
+ * @return		New reference to the list
+ */
+static PyObject* referenceReadingsList(const vector<Reading *>& readings)
+{
+	PyObject* readingsList = PyList_New(0);
+
+	for (vector<Reading *>::const_iterator elem = readings.begin();
+					       elem != readings.end();
+					       ++elem)
+	{
+		PyObject* readingObject = PyDict_New();
+		PyObject* newDataPoints = PyDict_New();
+
+		std::vector<Datapoint *>& dataPoints = (*elem)->getReadingData();
+		for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+		{
+			PyObject* value;
+			DatapointValue::dataTagType dataType = (*it)->getData().getType();
+
+			if (dataType == DatapointValue::dataTagType::T_INTEGER)
+			{
+				value = PyInt_FromLong((*it)->getData().toInt());
+			}
+			else if (dataType == DatapointValue::dataTagType::T_FLOAT)
+			{
+				value = PyFloat_FromDouble((*it)->getData().toDouble());
+			}
+			else
+			{
+				value = PyString_FromString((*it)->getData().toString().c_str());
+			}
+
+			PyDict_SetItemString(newDataPoints,
+					     (*it)->getName().c_str(),
+					     value);
+			Py_CLEAR(value);
+		}
+
+		PyDict_SetItemString(readingObject, "reading", newDataPoints);
+
+		PyObject* assetVal = PyString_FromString((*elem)->getAssetName().c_str());
+		PyDict_SetItemString(readingObject, "asset_code", assetVal);
+
+		PyObject* readingId = PyLong_FromUnsignedLong((*elem)->getId());
+		PyDict_SetItemString(readingObject, "id", readingId);
+
+		PyObject* readingTs = PyLong_FromUnsignedLong((*elem)->getTimestamp());
+		PyDict_SetItemString(readingObject, "ts", readingTs);
+
+		PyObject* readingUserTs = PyLong_FromUnsignedLong((*elem)->getUserTimestamp());
+		PyDict_SetItemString(readingObject, "user_ts", readingUserTs);
+
+		PyList_Append(readingsList, readingObject);
+
+		Py_CLEAR(newDataPoints);
+		Py_CLEAR(assetVal);
+		Py_CLEAR(readingId);
+		Py_CLEAR(readingTs);
+		Py_CLEAR(readingUserTs);
+		Py_CLEAR(readingObject);
+	}
+
+	return readingsList;
+}
+
+/**
+ * Reference conversion of the script result into new readings.
+ * Elements with an empty 'reading' dict are left out.
+ *
+ * @param filteredData	The script result (list of dicts)
+ * @param readings	The new readings
+ * @return		False if the result is not valid
+ */
+static bool referenceFilteredReadings(PyObject* filteredData, vector<Reading *>& readings)
+{
+	if (!PyList_Check(filteredData))
+	{
+		return false;
+	}
+
+	for (Py_ssize_t i = 0; i < PyList_Size(filteredData); i++)
+	{
+		// Borrowed references
+		PyObject* element = PyList_GetItem(filteredData, i);
+		PyObject* assetCode = element && PyDict_Check(element) ?
+				      PyDict_GetItemString(element, "asset_code") :
+				      NULL;
+		PyObject* reading = assetCode ?
+				    PyDict_GetItemString(element, "reading") :
+				    NULL;
+		if (!reading || !PyDict_Check(reading) || !PyString_Check(assetCode))
+		{
+			return false;
+		}
+
+		PyObject *dKey, *dValue;
+		Py_ssize_t dPos = 0;
+		Reading* newReading = NULL;
+
+		while (PyDict_Next(reading, &dPos, &dKey, &dValue))
+		{
+			DatapointValue* dataPoint;
+			if (PyInt_Check(dValue) || PyLong_Check(dValue))
+			{
+				dataPoint = new DatapointValue((long)PyInt_AsUnsignedLongMask(dValue));
+			}
+			else if (PyFloat_Check(dValue))
+			{
+				dataPoint = new DatapointValue(PyFloat_AS_DOUBLE(dValue));
+			}
+			else if (PyString_Check(dValue) && PyString_Check(dKey))
+			{
+				dataPoint = new DatapointValue(string(PyString_AsString(dValue)));
+			}
+			else
+			{
+				delete newReading;
+				return false;
+			}
+
+			if (newReading == NULL)
+			{
+				newReading = new Reading(PyString_AsString(assetCode),
+							 new Datapoint(PyString_AsString(dKey),
+								       *dataPoint));
+			}
+			else
+			{
+				newReading->addDatapoint(new Datapoint(PyString_AsString(dKey),
+								       *dataPoint));
+			}
+			delete dataPoint;
+
+			PyObject* id = PyDict_GetItemString(element, "id");
+			if (id && PyLong_Check(id))
+			{
+				newReading->setId(PyLong_AsUnsignedLong(id));
+			}
+			// Readings added by the script are timestamped when
+			// converted: 0 leaves their timestamps unchecked
+			PyObject* ts = PyDict_GetItemString(element, "ts");
+			newReading->setTimestamp(ts && PyLong_Check(ts) ?
+						 PyLong_AsUnsignedLong(ts) :
+						 0);
+			PyObject* uts = PyDict_GetItemString(element, "user_ts");
+			newReading->setUserTimestamp(uts && PyLong_Check(uts) ?
+						     PyLong_AsUnsignedLong(uts) :
+						     0);
+		}
+
+		if (newReading)
+		{
+			readings.push_back(newReading);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Compare a converted reading with its reference
+ *
+ * @param reference	The reference reading
+ * @param output	The reading to check
+ * @param inPlace	The reading has been updated in place: its unchanged
+ *			non numeric values are not the quoted string passed to
+ *			the script and its timestamps are the input ones
+ * @param difference	The first difference found
+ * @return		True if the readings are the same
+ */
+static bool compareReading(Reading* reference,
+			   Reading* output,
+			   bool inPlace,
+			   string& difference)
+{
+	if (reference->getAssetName() != output->getAssetName())
+	{
+		difference = "asset '" + output->getAssetName() +
+			     "', expected '" + reference->getAssetName() + "'";
+		return false;
+	}
+	if (!inPlace &&
+	    (reference->getId() != output->getId() ||
+	     (reference->getTimestamp() &&
+	      reference->getTimestamp() != output->getTimestamp()) ||
+	     (reference->getUserTimestamp() &&
+	      reference->getUserTimestamp() != output->getUserTimestamp())))
+	{
+		difference = "asset '" + reference->getAssetName() + "' id or timestamps";
+		return false;
+	}
+
+	vector<Datapoint *>& expected = reference->getReadingData();
+	vector<Datapoint *>& actual = output->getReadingData();
+	if (expected.size() != actual.size())
+	{
+		difference = "asset '" + reference->getAssetName() + "' datapoint count";
+		return false;
+	}
+
+	// Datapoint order may differ when updated in place
+	for (vector<Datapoint *>::iterator it = expected.begin(); it != expected.end(); ++it)
+	{
+		string name = (*it)->getName();
+		Datapoint* found = output->getDatapoint(name);
+		if (!found)
+		{
+			difference = "asset '" + reference->getAssetName() +
+				     "' missing datapoint '" + name + "'";
+			return false;
+		}
+
+		DatapointValue& expectedValue = (*it)->getData();
+		DatapointValue& actualValue = found->getData();
+		if (expectedValue.getType() == actualValue.getType() &&
+		    expectedValue.toString() == actualValue.toString())
+		{
+			continue;
+		}
+		if (inPlace &&
+		    expectedValue.getType() == DatapointValue::dataTagType::T_STRING &&
+		    actualValue.getType() != DatapointValue::dataTagType::T_INTEGER &&
+		    actualValue.getType() != DatapointValue::dataTagType::T_FLOAT &&
+		    expectedValue.toStringValue() == actualValue.toString())
+		{
+			// Unchanged value kept with its original type
+			continue;
+		}
+		difference = "asset '" + reference->getAssetName() +
+			     "' datapoint '" + name + "' value " + actualValue.toString() +
+			     ", expected " + expectedValue.toString();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Compare the filter output with the expected readings
+ *
+ * @param expected	The expected readings
+ * @param output	The filter output
+ * @param inPlace	The output has been updated in place
+ * @param difference	The first difference found
+ * @return		True if the readings are the same
+ */
+static bool compareReadings(const vector<Reading *>& expected,
+			    const vector<Reading *>& output,
+			    bool inPlace,
+			    string& difference)
+{
+	if (expected.size() != output.size())
+	{
+		char buffer[80];
+		snprintf(buffer,
+			 sizeof(buffer),
+			 "%lu readings, expected %lu",
+			 (unsigned long)output.size(),
+			 (unsigned long)expected.size());
+		difference = buffer;
+		return false;
+	}
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		if (!compareReading(expected[i], output[i], inPlace, difference))
+		{
+			difference = "reading #" + to_string(i) + ": " + difference;
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Run one batch through the filter and through the reference
+ * conversions, with the same script run in this process
+ *
+ * @param filter	The filter instance
+ * @param module	The script module
+ * @param method	The script method name
+ * @param mode		The output mode of the filter
+ * @param input		The batch
+ * @param difference	The first difference found
+ * @return		True if the filter input and output are the expected ones
+ */
+static bool checkBatch(BenchmarkFilter& filter,
+		       PyObject* module,
+		       const char* method,
+		       const TestMode& mode,
+		       ReadingSet* input,
+		       string& difference)
+{
+	// The filter takes the batch: keep a copy
+	vector<Reading *> copies;
+	const vector<Reading *>& readings = input->getAllReadings();
+	for (size_t i = 0; i < readings.size(); i++)
+	{
+		copies.push_back(new Reading(*readings[i]));
+	}
+
+	filter.ingest(input);
+	ReadingSet* output = filter.takeOutput();
+
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyObject* reference = referenceReadingsList(copies);
+
+	// Script input
+	bool success = true;
+	PyObject* lastInput = PyObject_GetAttrString(module, "last_input");
+	if (!lastInput || PyObject_RichCompareBool(lastInput, reference, Py_EQ) != 1)
+	{
+		difference = "script input differs from the reference list";
+		success = false;
+	}
+	Py_XDECREF(lastInput);
+
+	// Filter output
+	string outputMode = mode.outputMode;
+	vector<Reading *> expected;
+	if (success)
+	{
+		if (outputMode == "Append")
+		{
+			// The input readings are followed by the script result
+			expected = copies;
+			copies.clear();
+		}
+		PyObject* result = PyObject_CallMethod(module, (char *)method, (char *)"O", reference);
+		if (!result || !referenceFilteredReadings(result, expected))
+		{
+			difference = "the reference conversion failed";
+			success = false;
+		}
+		Py_XDECREF(result);
+	}
+	PyErr_Clear();
+	Py_DECREF(reference);
+	PyGILState_Release(state);
+
+	if (success)
+	{
+		if (!output)
+		{
+			difference = "no output";
+			success = false;
+		}
+		else
+		{
+			success = compareReadings(expected,
+						  output->getAllReadings(),
+						  outputMode == "Update in place",
+						  difference);
+		}
+	}
+
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		delete expected[i];
+	}
+	for (size_t i = 0; i < copies.size(); i++)
+	{
+		delete copies[i];
+	}
+	delete output;
+	return success;
+}
+
+static void usage(const char* program)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -b batches       batches run through each script and output mode (default %d)\n"
+		"  -s seed          seed of the generated batches (default random)\n",
+		program,
+		MARSHALLING_BATCHES);
+}
+
+/**
+ * Run random batches through filters dropping, changing, adding
+ * and reordering readings, with each output mode, and compare the
+ * script input and the filter output with the reference conversions
+ * the filter was first written with.
+ */
+int main(int argc, char* argv[])
+{
+	unsigned long batches = MARSHALLING_BATCHES;
+	unsigned long seed = time(NULL);
+
+	int option;
+	while ((option = getopt(argc, argv, "b:s:")) != -1)
+	{
+		switch (option)
+		{
+			case 'b':
+				batches = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+	if (optind != argc)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (!setupBenchmark())
+	{
+		return 2;
+	}
+	printf("Seed %lu\n", seed);
+	ReadingGenerator generator(seed);
+
+	int failed = 0;
+	for (size_t script = 0; script < SCRIPTS; script++)
+	{
+		string file = writeScript(scripts[script].name,
+					  string(recordScript) + scripts[script].body);
+		if (file.empty())
+		{
+			return 2;
+		}
+
+		for (size_t mode = 0; mode < MODES; mode++)
+		{
+			string modeItems = string(", \"outputMode\": {\"description\": \"\", "
+						  "\"type\": \"enumeration\", "
+						  "\"options\": [\"Replace\", \"Update in place\", \"Append\"], "
+						  "\"default\": \"Replace\", \"value\": \"") +
+					   modes[mode].outputMode + "\"}, "
+					   "\"conversionThreads\": {\"description\": \"\", "
+						  "\"type\": \"integer\", "
+						  "\"default\": \"0\", \"value\": \"" +
+					   modes[mode].conversionThreads + "\"}";
+			BenchmarkFilter filter(string("test-marshalling-") + scripts[script].name,
+					       file,
+					       modeItems);
+			if (!filter.ready())
+			{
+				return 2;
+			}
+			filter.keepOutput(true);
+
+			// The module imported by the filter
+			PyGILState_STATE state = PyGILState_Ensure();
+			PyObject* module = PyImport_ImportModule((string("benchmark_script_") +
+								  scripts[script].name).c_str());
+			if (!module)
+			{
+				PyErr_Print();
+			}
+			PyGILState_Release(state);
+			if (!module)
+			{
+				return 2;
+			}
+
+			// Large batches for the thread pool
+			bool parallel = string(modes[mode].conversionThreads) != "0";
+			unsigned long modeBatches = parallel ? batches / 20 + 1 : batches;
+			unsigned long batch;
+			string difference;
+			for (batch = 0; batch < modeBatches; batch++)
+			{
+				ReadingSet* input = parallel ?
+						    generator.batch(MARSHALLING_PARALLEL_READINGS * 3 / 2,
+								    MARSHALLING_PARALLEL_READINGS * 2) :
+						    generator.batch(0, MARSHALLING_MAX_READINGS);
+				if (!checkBatch(filter,
+						module,
+						scripts[script].name,
+						modes[mode],
+						input,
+						difference))
+				{
+					break;
+				}
+			}
+			printf("%-8s %-17s %s",
+			       scripts[script].name,
+			       modes[mode].name,
+			       batch == modeBatches ? "passed\n" : "FAILED: ");
+			if (batch != modeBatches)
+			{
+				printf("batch %lu, %s\n", batch, difference.c_str());
+				failed = 1;
+			}
+
+			state = PyGILState_Ensure();
+			Py_DECREF(module);
+			PyGILState_Release(state);
+		}
+	}
+	return failed;
+}
@@ -0,0 +1,294 @@
+/*
+ * Fledge "Python 2.7" filter soak test.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <Python.h>
+
+#include "benchmark.h"
+
+using namespace std;
+
+// Batches run through each script, if not given
+#define SOAK_BATCHES 2000000
+// Readings per batch, if not given
+#define SOAK_BATCH_SIZE 10
+// Samples of the Python objects and the resident memory
+#define SOAK_SAMPLES 20
+// Growth since the first sample reported as a leak, if not given
+#define SOAK_MAX_OBJECTS 1000
+#define SOAK_MAX_RESIDENT_KB 16384
+// Types listed in a leak report
+#define SOAK_TOP_TYPES 5
+
+// The exponential moving average example of the documentation
+static const char* emaScript =
+	"rate = 0.07\n"
+	"latest = None\n"
+	"\n"
+	"def doit(reading):\n"
+	"    global rate, latest\n"
+	"\n"
+	"    for attribute in list(reading):\n"
+	"        if not latest:\n"
+	"            latest = reading[attribute]\n"
+	"        else:\n"
+	"            latest = reading[attribute] * rate + latest * (1 - rate)\n"
+	"        reading[b'ema'] = latest\n"
+	"\n"
+	"def ema(readings):\n"
+	"    for elem in list(readings):\n"
+	"        doit(elem['reading'])\n"
+	"    return readings\n";
+
+/**
+ * Objects tracked by the Python garbage collector
+ * and resident memory of the process
+ */
+typedef struct
+{
+	unordered_map<string, long>	types;
+	long				objects;
+	long				rss;
+} SoakSample;
+
+static void usage(const char* program)
+{
+	fprintf(stderr,
+		"Usage: %s [options] readings27.py\n"
+		"  -b batches       batches run through each script (default %d)\n"
+		"  -n readings      readings per batch (default %d)\n"
+		"  -o objects       Python object growth reported as a leak (default %d)\n"
+		"  -m kB            resident memory growth reported as a leak (default %d)\n",
+		program,
+		SOAK_BATCHES,
+		SOAK_BATCH_SIZE,
+		SOAK_MAX_OBJECTS,
+		SOAK_MAX_RESIDENT_KB);
+}
+
+/**
+ * Collect the garbage and count the objects tracked by
+ * the garbage collector, by type, and the resident memory
+ *
+ * @param sample	The counts
+ * @return		False if the gc module failed
+ */
+static bool takeSample(SoakSample& sample)
+{
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyObject* gc = PyImport_ImportModule("gc");
+	PyObject* collected = gc ? PyObject_CallMethod(gc, (char *)"collect", NULL) : NULL;
+	PyObject* all = collected ? PyObject_CallMethod(gc, (char *)"get_objects", NULL) : NULL;
+	bool success = all && PyList_Check(all);
+	if (success)
+	{
+		// Count by type object first: one pointer hash per object
+		unordered_map<PyTypeObject*, long> byType;
+		sample.objects = PyList_GET_SIZE(all);
+		for (Py_ssize_t i = 0; i < sample.objects; i++)
+		{
+			byType[Py_TYPE(PyList_GET_ITEM(all, i))]++;
+		}
+		// Type names, while the types are alive
+		sample.types.clear();
+		for (unordered_map<PyTypeObject*, long>::const_iterator it = byType.begin();
+								       it != byType.end();
+								       ++it)
+		{
+			sample.types[it->first->tp_name] += it->second;
+		}
+	}
+	else
+	{
+		PyErr_Print();
+	}
+	Py_XDECREF(all);
+	Py_XDECREF(collected);
+	Py_XDECREF(gc);
+	PyGILState_Release(state);
+
+	sample.rss = residentKb();
+	return success;
+}
+
+/**
+ * Print the types that have grown the most between two samples
+ *
+ * @param first		The first sample
+ * @param last		The last sample
+ */
+static void printGrowth(const SoakSample& first, const SoakSample& last)
+{
+	vector<pair<long, string> > growth;
+	for (unordered_map<string, long>::const_iterator it = last.types.begin();
+						      it != last.types.end();
+						      ++it)
+	{
+		unordered_map<string, long>::const_iterator base = first.types.find(it->first);
+		long delta = it->second - (base != first.types.end() ? base->second : 0);
+		if (delta > 0)
+		{
+			growth.push_back(make_pair(delta, it->first));
+		}
+	}
+	size_t topN = min(growth.size(), (size_t)SOAK_TOP_TYPES);
+	partial_sort(growth.begin(), growth.begin() + topN, growth.end(),
+		     [](const pair<long, string>& a, const pair<long, string>& b)
+		     {
+			     return a.first > b.first;
+		     });
+	for (size_t i = 0; i < topN; i++)
+	{
+		printf("  %+ld objects of type '%s'\n", growth[i].first, growth[i].second.c_str());
+	}
+}
+
+/**
+ * Run batches through a filter and check the Python objects
+ * and the resident memory do not grow. The first sample is
+ * taken after one interval, once the caches of the filter
+ * are filled.
+ *
+ * @param name		The filter category name
+ * @param script	The script path
+ * @param config	The JSON configuration of the script
+ * @param batches	The batches to run
+ * @param batchSize	The readings per batch
+ * @param maxObjects	Object growth reported as a leak
+ * @param maxRss	Resident memory growth reported as a leak, kB
+ * @return		0 if no leak is found, 1 on a leak, 2 on error
+ */
+static int soak(const string& name,
+		const string& script,
+		const string& config,
+		unsigned long batches,
+		unsigned long batchSize,
+		long maxObjects,
+		long maxRss)
+{
+	BenchmarkFilter filter(name, script, "", config);
+	if (!filter.ready())
+	{
+		return 2;
+	}
+
+	printf("Script %s, %lu batches of %lu readings\n", name.c_str(), batches, batchSize);
+	printf("%12s %12s %12s\n", "batches", "objects", "RSS kB");
+
+	unsigned long interval = max(batches / SOAK_SAMPLES, 1UL);
+	SoakSample first, last;
+	bool sampled = false;
+	for (unsigned long batch = 1; batch <= batches; batch++)
+	{
+		filter.ingest(createBatch(SHAPE_TEMPERATURE, batchSize));
+		if (batch % interval != 0 && batch != batches)
+		{
+			continue;
+		}
+		if (!takeSample(sampled ? last : first))
+		{
+			return 2;
+		}
+		const SoakSample& sample = sampled ? last : first;
+		printf("%12lu %12ld %12ld\n", batch, sample.objects, sample.rss);
+		fflush(stdout);
+		sampled = true;
+	}
+	if (filter.forwarded() == 0)
+	{
+		fprintf(stderr, "Script %s: no reading forwarded\n", name.c_str());
+		return 2;
+	}
+
+	long objects = last.objects - first.objects;
+	long rss = last.rss - first.rss;
+	if (objects > maxObjects || rss > maxRss)
+	{
+		printf("Script %s: possible leak, %+ld objects, %+ld kB\n",
+		       name.c_str(),
+		       objects,
+		       rss);
+		printGrowth(first, last);
+		return 1;
+	}
+	printf("Script %s: passed, %+ld objects, %+ld kB\n", name.c_str(), objects, rss);
+	return 0;
+}
+
+/**
+ * Run millions of batches through the filter with the readings27.py
+ * script and the exponential moving average example of the
+ * documentation, and fail if the Python objects or the resident
+ * memory of the process keep growing.
+ */
+int main(int argc, char* argv[])
+{
+	unsigned long batches = SOAK_BATCHES;
+	unsigned long batchSize = SOAK_BATCH_SIZE;
+	long maxObjects = SOAK_MAX_OBJECTS;
+	long maxRss = SOAK_MAX_RESIDENT_KB;
+
+	int option;
+	while ((option = getopt(argc, argv, "b:n:o:m:")) != -1)
+	{
+		switch (option)
+		{
+			case 'b':
+				batches = strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				batchSize = strtoul(optarg, NULL, 10);
+				break;
+			case 'o':
+				maxObjects = strtol(optarg, NULL, 10);
+				break;
+			case 'm':
+				maxRss = strtol(optarg, NULL, 10);
+				break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+	if (optind != argc - 1 || batches == 0 || batchSize == 0)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (!setupBenchmark())
+	{
+		return 2;
+	}
+	string readings27 = copyScript(argv[optind], "readings27");
+	string ema = writeScript("ema", emaScript);
+	if (readings27.empty() || ema.empty())
+	{
+		return 2;
+	}
+
+	int result = soak("readings27",
+			  readings27,
+			  "{\"asset_code\": [\"temperature\"]}",
+			  batches,
+			  batchSize,
+			  maxObjects,
+			  maxRss);
+	if (result != 2)
+	{
+		result = max(result, soak("ema", ema, "{}", batches, batchSize, maxObjects, maxRss));
+	}
+	return result;
+}
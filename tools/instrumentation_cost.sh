@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# Fledge "Python 2.7" filter instrumentation cost.
+#
+# Copyright (c) 2026 Dianomic Systems
+#
+# Released under the Apache 2.0 Licence
+#
+# Compare the plugin built with the none instrumentation level with the
+# plugin as it was before the instrumentation, on the same corpus. The
+# benchmark of this tree is built twice: linked with the plugin of the
+# baseline commit, which writes the baseline results, and with the
+# plugin of this tree built with the none level, which is compared with
+# them. A negative throughput or latency change is the cost of the
+# instrumentation left when it is disabled.
+#
+# Usage: tools/instrumentation_cost.sh [build directory] [benchmark options]
+#
+# The build directory defaults to build-instrumentation, the benchmark
+# options to -t 2. The baseline commit defaults to 98543c4, set
+# BASELINE_COMMIT to change it. Options of cmake are passed in CMAKE_ARGS.
+#
+
+set -e
+
+source=$(cd "$(dirname "$0")/.." && pwd)
+builds=${1:-build-instrumentation}
+[ $# -gt 0 ] && shift
+options=${*:--t 2}
+baseline=${BASELINE_COMMIT:-98543c4}
+
+mkdir -p "$builds"
+builds=$(cd "$builds" && pwd)
+
+# Plugin of the baseline commit, built with its own CMakeLists.txt
+rm -rf "$builds/baseline-source"
+mkdir -p "$builds/baseline-source"
+git -C "$source" archive "$baseline" | tar -x -C "$builds/baseline-source"
+cmake -S "$builds/baseline-source" -B "$builds/baseline-plugin" $CMAKE_ARGS
+cmake --build "$builds/baseline-plugin" --target python27 -j "$(nproc)"
+
+# Benchmark of this tree linked with the baseline plugin
+cmake -S "$source" -B "$builds/baseline" \
+	-DPYTHON27_BENCHMARK=ON \
+	-DPYTHON27_BENCHMARK_PLUGIN="$builds/baseline-plugin/libpython27.so" \
+	$CMAKE_ARGS
+cmake --build "$builds/baseline" --target python27_benchmark -j "$(nproc)"
+
+# Benchmark and plugin of this tree without instrumentation
+cmake -S "$source" -B "$builds/none" \
+	-DPYTHON27_BENCHMARK=ON \
+	-DPYTHON27_INSTRUMENTATION=none \
+	$CMAKE_ARGS
+cmake --build "$builds/none" --target python27_benchmark -j "$(nproc)"
+
+echo "Baseline $baseline"
+"$builds/baseline/python27_benchmark" $options -o "$builds/baseline.json"
+echo "Instrumentation none compared with $baseline"
+# Exits with 1 if the none build is slower than the baseline
+"$builds/none/python27_benchmark" $options -b "$builds/baseline.json"
@@ -0,0 +1,189 @@
+/*
+ * Fledge "Python 2.7" filter statistics reader.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Prints the counters published in shared memory by the python27
+ * filter instances of the running Fledge services.
+ *
+ * Usage: python27_stats [-i seconds] [filter name ...]
+ *
+ * With no filter names all the python27 filters are shown,
+ * with -i the counters are printed every given seconds.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "statistics_page.h"
+
+// Where Linux exposes POSIX shared memory segments
+#define SHM_DIRECTORY "/dev/shm"
+
+using namespace std;
+
+static const char* stageNames[STAGE_COUNT] = {
+	"gil wait", "create", "script", "convert", "forward"
+};
+
+static const char* phaseNames[STARTUP_COUNT] = {
+	"interpreter", "path", "import", "config"
+};
+
+/**
+ * Find the statistics segments of all the python27 filters
+ *
+ * @return	The segment names
+ */
+static vector<string> findSegments()
+{
+	vector<string> segments;
+	DIR* dir = opendir(SHM_DIRECTORY);
+	if (!dir)
+	{
+		return segments;
+	}
+	// Segment names start with '/', directory entries do not
+	const char* prefix = STATISTICS_PAGE_PREFIX + 1;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0)
+		{
+			segments.push_back(string("/") + entry->d_name);
+		}
+	}
+	closedir(dir);
+	return segments;
+}
+
+/**
+ * Print the counters of a statistics segment
+ *
+ * @param segment	The segment name
+ * @return		False if the segment can not be read
+ */
+static bool printSegment(const string& segment)
+{
+	int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		fprintf(stderr, "%s: %s\n", segment.c_str(), strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	void* memory = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(StatisticsLayout))
+	{
+		memory = mmap(NULL, sizeof(StatisticsLayout), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: not a python27 statistics segment\n", segment.c_str());
+		return false;
+	}
+
+	const StatisticsLayout* layout = (const StatisticsLayout *)memory;
+	if (layout->magic != STATISTICS_PAGE_MAGIC ||
+	    layout->version != STATISTICS_PAGE_VERSION)
+	{
+		fprintf(stderr, "%s: unsupported layout version %u\n",
+			segment.c_str(),
+			layout->version);
+		munmap(memory, sizeof(StatisticsLayout));
+		return false;
+	}
+
+	uint64_t batches = layout->batches.load(memory_order_relaxed);
+	printf("%s (pid %u)\n", layout->filterName, layout->pid);
+	printf("  batches %lu, readings in %lu, readings out %lu, errors %lu\n",
+	       (unsigned long)batches,
+	       (unsigned long)layout->readingsIn.load(memory_order_relaxed),
+	       (unsigned long)layout->readingsOut.load(memory_order_relaxed),
+	       (unsigned long)layout->errors.load(memory_order_relaxed));
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		uint64_t total = layout->stageTime[stage].load(memory_order_relaxed);
+		printf("  %-8s total %.3f ms, average %.1f us\n",
+		       stageNames[stage],
+		       total / 1e6,
+		       batches ? total / 1e3 / batches : 0.0);
+	}
+	printf("  queue depth: asset tracking %lu, reclaimer %lu\n",
+	       (unsigned long)layout->assetTrackingDepth.load(memory_order_relaxed),
+	       (unsigned long)layout->reclaimerDepth.load(memory_order_relaxed));
+	printf("  plugin_init:");
+	for (int phase = 0; phase < STARTUP_COUNT; phase++)
+	{
+		printf(" %s %.3f ms",
+		       phaseNames[phase],
+		       layout->startupTime[phase].load(memory_order_relaxed) / 1e6);
+	}
+	printf("\n");
+
+	munmap(memory, sizeof(StatisticsLayout));
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int interval = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "i:")) != -1)
+	{
+		if (opt == 'i')
+		{
+			interval = atoi(optarg);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-i seconds] [filter name ...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	do
+	{
+		vector<string> segments;
+		for (int i = optind; i < argc; i++)
+		{
+			segments.push_back(StatisticsPage::segmentName(argv[i]));
+		}
+		if (segments.empty())
+		{
+			segments = findSegments();
+		}
+
+		bool found = false;
+		for (vector<string>::iterator it = segments.begin(); it != segments.end(); ++it)
+		{
+			found |= printSegment(*it);
+		}
+		if (!found && !interval)
+		{
+			fprintf(stderr, "No python27 filter statistics found\n");
+			return 1;
+		}
+		fflush(stdout);
+
+		if (interval)
+		{
+			sleep(interval);
+		}
+	} while (interval);
+
+	return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Fledge "Python 2.7" filter ingest span tracing.
+ *
+ * Copyright (c) 2026 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <logger.h>
+
+#include "trace_buffer.h"
+
+using namespace std;
+
+// Trace event names of the ingest stages
+static const char* traceStageNames[STAGE_COUNT] = {
+	"GIL wait", "create", "script", "convert", "forward"
+};
+
+/**
+ * Return the process wide trace buffer
+ */
+TraceBuffer* TraceBuffer::getInstance()
+{
+	static TraceBuffer instance;
+	return &instance;
+}
+
+/**
+ * Constructor: start the writer thread
+ */
+TraceBuffer::TraceBuffer() :
+		m_dropped(0),
+		m_stop(false),
+		m_files(0)
+{
+	m_writer = thread(&TraceBuffer::run, this);
+}
+
+/**
+ * Destructor: write the pending buffers and stop the writer thread
+ */
+TraceBuffer::~TraceBuffer()
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	m_writer.join();
+}
+
+/**
+ * Set the Fledge data directory the trace files are written to
+ *
+ * @param dataDir	The Fledge data directory
+ */
+void TraceBuffer::setDataDir(const string& dataDir)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_dataDir = dataDir;
+}
+
+/**
+ * Add the span of an ingest stage, the buffer
+ * is passed to the writer thread when it is full
+ *
+ * @param filterName	The filter category name, it must
+ *			outlive the next flush()
+ * @param stage		The ingest stage
+ * @param start		Monotonic clock start, in nanoseconds
+ * @param end		Monotonic clock end, in nanoseconds
+ * @param readings	Readings in the batch
+ */
+void TraceBuffer::add(const string* filterName,
+		      IngestStage stage,
+		      uint64_t start,
+		      uint64_t end,
+		      unsigned long readings)
+{
+	static __thread long tid = 0;
+	if (!tid)
+	{
+		tid = syscall(SYS_gettid);
+	}
+
+	TraceSpan span;
+	span.filterName = filterName;
+	span.stage = stage;
+	span.tid = tid;
+	span.start = start;
+	span.duration = end - start;
+	span.readings = readings;
+
+	lock_guard<mutex> guard(m_mutex);
+	if (m_spans.capacity() < TRACE_BUFFER_SPANS)
+	{
+		m_spans.reserve(TRACE_BUFFER_SPANS);
+	}
+	m_spans.push_back(span);
+	if (m_spans.size() >= TRACE_BUFFER_SPANS)
+	{
+		this->pend();
+	}
+}
+
+/**
+ * Pass the buffered spans to the writer thread, or drop them
+ * if it is late. Called with the mutex held.
+ */
+void TraceBuffer::pend()
+{
+	if (m_pending.size() >= TRACE_PENDING_BUFFERS)
+	{
+		m_dropped += m_spans.size();
+		m_spans.clear();
+		return;
+	}
+	m_pending.push_back(vector<TraceSpan>());
+	m_pending.back().swap(m_spans);
+	m_condition.notify_all();
+}
+
+/**
+ * Write the buffered spans to a new file and wait for
+ * the writer thread to complete all the pending files.
+ * Called by each traced filter before it is deleted,
+ * as the spans refer to the filter name.
+ */
+void TraceBuffer::flush()
+{
+	unique_lock<mutex> lock(m_mutex);
+	if (!m_spans.empty())
+	{
+		this->pend();
+	}
+	while (!m_pending.empty())
+	{
+		m_condition.wait(lock);
+	}
+}
+
+/**
+ * Writer thread: write the pending buffers, one file each,
+ * until the buffer is destroyed
+ */
+void TraceBuffer::run()
+{
+	unique_lock<mutex> lock(m_mutex);
+	while (true)
+	{
+		if (m_dropped)
+		{
+			Logger::getLogger()->warn("Ingest trace: %lu spans dropped, "
+						  "the trace files are not written fast enough",
+						  m_dropped);
+			m_dropped = 0;
+		}
+		if (!m_pending.empty())
+		{
+			// The buffer stays pending until written, for flush()
+			string dataDir = m_dataDir;
+			vector<TraceSpan>& spans = m_pending.front();
+			lock.unlock();
+			write(dataDir, spans);
+			lock.lock();
+			m_pending.pop_front();
+			m_condition.notify_all();
+			continue;
+		}
+		if (m_stop)
+		{
+			return;
+		}
+		m_condition.wait(lock);
+	}
+}
+
+/**
+ * Append a JSON string to a file
+ *
+ * @param file	The output file
+ * @param value	The string to quote
+ */
+static void writeJSONString(FILE* file, const string& value)
+{
+	fputc('"', file);
+	for (string::const_iterator c = value.begin(); c != value.end(); ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+			fputc(*c, file);
+		}
+		else if ((unsigned char)*c < 0x20)
+		{
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		}
+		else
+		{
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+/**
+ * Write spans as a Chrome trace-event JSON file:
+ * one complete ("X") event per span, timestamps in microseconds.
+ * Called by the writer thread, without the mutex held.
+ *
+ * @param dataDir	The Fledge data directory
+ * @param spans		The spans to write
+ */
+void TraceBuffer::write(const string& dataDir, const vector<TraceSpan>& spans)
+{
+	string dir = dataDir + TRACE_FILES_PATH;
+	// The logs directory may not exist yet
+	mkdir((dataDir + "/logs").c_str(), 0755);
+	mkdir(dir.c_str(), 0755);
+
+	pid_t pid = getpid();
+	char name[64];
+	snprintf(name, sizeof(name), "/trace-%d-%u.json", (int)pid, ++m_files);
+	string path = dir + name;
+
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+	{
+		Logger::getLogger()->warn("Unable to write ingest trace file '%s': %s",
+					  path.c_str(),
+					  strerror(errno));
+		return;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+	for (vector<TraceSpan>::const_iterator span = spans.begin();
+					       span != spans.end();
+					       ++span)
+	{
+		if (span != spans.begin())
+		{
+			fputs(",\n", file);
+		}
+		fprintf(file,
+			"{\"name\":\"%s\",\"cat\":\"python27\",\"ph\":\"X\","
+			"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%ld,"
+			"\"args\":{\"filter\":",
+			traceStageNames[span->stage],
+			span->start / 1e3,
+			span->duration / 1e3,
+			(int)pid,
+			span->tid);
+		writeJSONString(file, *span->filterName);
+		fprintf(file, ",\"readings\":%lu}}", span->readings);
+	}
+	fputs("]}\n", file);
+
+	if (fclose(file) != 0)
+	{
+		Logger::getLogger()->warn("Unable to write ingest trace file '%s': %s",
+					  path.c_str(),
+					  strerror(errno));
+		return;
+	}
+
+	Logger::getLogger()->info("Ingest trace of %lu spans written to '%s'",
+				  spans.size(),
+				  path.c_str());
+}